@@ -45,6 +45,8 @@ void update_selected_solutions(rundata *run, solmemory *solmem,
         for(int i=0;i<n_cands;i++){
             solution *sol = cands[i];
             if(sel[i]){
+                // Selected solutions outlive the arena of their generation, so they are moved to the heap
+                if(sol->in_arena) sol = solution_copy(run->prob,sol);
                 solmem->selectpool[solmem->n_selectpool] = sol;
                 solmem->n_selectpool += 1;
             }else{
@@ -128,6 +130,9 @@ solution **new_find_best_solutions(rundata *run, redstrategy *rstrats, int n_rst
     solmem.n_final   = 0;
     solmem.final     = safe_malloc(sizeof(solution *)*run->target_sols*2);
 
+    // Pool of memory blocks for the arenas of each generation
+    solarena_pool *arena_pool = solarena_pool_init();
+
     for(int r=0;r<run->n_restarts;r++){
 
         // Initialize terminal pool
@@ -141,10 +146,13 @@ solution **new_find_best_solutions(rundata *run, redstrategy *rstrats, int n_rst
 
         if(run->verbose) printf("\n== RESTART %d/%d ==\n",r+1,run->n_restarts);
 
-        // The previous generation
+        // The previous generation, and the number of solutions it had before only the best were kept
         int prev_n_sols = 1;
+        int prev_n_children = 1;
         solution **prev_sols = safe_malloc(sizeof(solution *)*prev_n_sols);
         prev_sols[0] = solution_empty(prob);
+        // Arena where the solutions of the previous generation are (none for the empty solution)
+        solarena *prev_arena = NULL;
 
         int csize = 0; // Current solution size, last base computed
         while(prev_n_sols>0){
@@ -162,7 +170,7 @@ solution **new_find_best_solutions(rundata *run, redstrategy *rstrats, int n_rst
 
             // Save number of solutions after expansion
             if(first_restart && run->local_search){
-                run->run_inf->firstr_per_size_n_sols[csize] = prev_n_sols;
+                run->run_inf->firstr_per_size_n_sols[csize] = prev_n_children;
             }
 
             // Apply the reduction strategies
@@ -177,9 +185,21 @@ solution **new_find_best_solutions(rundata *run, redstrategy *rstrats, int n_rst
                 run->run_inf->firstr_per_size_n_sols_after_red[csize] = prev_n_sols;
             }
 
+            // Compact the remaining solutions on a new arena, so the memory of the reduced ones is released
+            if(prev_arena!=NULL){
+                solarena *compact_arena = solarena_init(prob,csize,run->precomp->sketch_size,1,arena_pool);
+                for(int i=0;i<prev_n_sols;i++){
+                    prev_sols[i] = solarena_copy(compact_arena,0,prob,prev_sols[i]);
+                }
+                solarena_free(prev_arena);
+                prev_arena = compact_arena;
+            }
+
             // Expand solutions from the previous generation to create the next one
             int next_n_sols = 0;
+            int next_n_children = 0;
             solution **next_sols = NULL;
+            solarena *next_arena = NULL;
 
             if(csize<prob->n_facs && prev_n_sols>0){
                 if(prob->size_restriction_maximum==-1 || csize<prob->size_restriction_maximum){
@@ -190,17 +210,34 @@ solution **new_find_best_solutions(rundata *run, redstrategy *rstrats, int n_rst
                     for(int s=0;s<n_rstrats;s++){
                         if(!rstrats[s].for_selected_sols) pool_size = rstrats[s].n_target;
                     }
-                    // Expand solutions to get the next generation
-                    next_sols = new_expand_solutions(run,prev_sols,prev_n_sols,&next_n_sols,pool_size);
+                    // If the first reduction picks the best solutions, only them have to be kept by the expansion
+                    // (unless B&B, that is applied before the reductions, is used)
+                    int n_best = 0;
+                    for(int s=0;s<n_rstrats;s++){
+                        if(!rstrats[s].for_selected_sols){
+                            if(rstrats[s].method==REDUCTION_BESTS && !run->branch_and_bound) n_best = rstrats[s].n_target;
+                            break;
+                        }
+                    }
+                    // Expand solutions to get the next generation, on a new arena
+                    next_arena = solarena_init(prob,csize+1,run->precomp->sketch_size,run->n_threads,arena_pool);
+                    next_sols = new_expand_solutions(run,prev_sols,prev_n_sols,&next_n_sols,&next_n_children,
+                        pool_size,n_best,next_arena);
+                    if(run->verbose && next_n_sols<next_n_children){
+                        printf("Kept the best \033[31;1m%d\033[0m of \033[31;1m%d\033[0m new solutions.\n",next_n_sols,next_n_children);
+                    }
                 }
             }
 
             // Add the prev generation solutions in the selected solutions and free their memory
             update_selected_solutions(run,&solmem,prev_sols,prev_n_sols,csize,r);
+            if(prev_arena!=NULL) solarena_free(prev_arena);
 
             // Now the current gen is the previous one
             prev_n_sols = next_n_sols;
+            prev_n_children = next_n_children;
             prev_sols = next_sols;
+            prev_arena = next_arena;
 
             // Increase csize
             csize += 1;
@@ -209,6 +246,8 @@ solution **new_find_best_solutions(rundata *run, redstrategy *rstrats, int n_rst
 
         }
         run->run_inf->total_n_iterations += csize;
+        // Free the arena of the last generation, that has no solutions
+        if(prev_arena!=NULL) solarena_free(prev_arena);
 
         if(run->verbose) printf("\nStarting final reduction with \033[34;1m%d\033[0m selected solutions:\n",solmem.n_selectpool);
 
@@ -309,6 +348,9 @@ solution **new_find_best_solutions(rundata *run, redstrategy *rstrats, int n_rst
 
 
     }
+    // Free the memory blocks of the arenas
+    solarena_pool_free(arena_pool);
+
     // Retrieve the final solutions:
     *out_n_sols = solmem.n_final;
 
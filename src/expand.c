@@ -1,31 +1,45 @@
 #include "expand.h"
 
+#include <sys/time.h>
+
 //#############################################################
 // FUTURESOLS
 //#############################################################
 
 // Possible future solution that results from another one.
+// Its facilities are the ones of the origin plus newf, they aren't copied so that all the
+// children of a generation can be represented with little memory.
 typedef struct {
     solution *origin;
     int newf;
-    uint hash;
-    int n_facs;
-    int facs[0]; // Flexible array member.
+    int newf_pos; // Position of newf on the sorted facilities of the future solution.
+    uint64_t hash; // Zobrist hash of the facilities.
 } futuresol;
 
-// Compares futuresols so that similar are consecutive.
-int futuresol_cmp(const void *a, const void *b){
-    const futuresol *aa = (const futuresol *) a;
-    const futuresol *bb = (const futuresol *) b;
-    if(aa->hash>bb->hash) return +1;
-    if(aa->hash<bb->hash) return -1;
-    int nf_delta = aa->n_facs - bb->n_facs;
-    if(nf_delta!=0) return nf_delta;
-    for(int i=0;i<aa->n_facs;i++){
-        int idx_delta = aa->facs[i]-bb->facs[i];
-        if(idx_delta!=0) return idx_delta;
+// Gets the i-th (sorted) facility of the future solution.
+static inline int futuresol_fac(const futuresol *fsol, int i){
+    if(i<fsol->newf_pos) return fsol->origin->facs[i];
+    if(i==fsol->newf_pos) return fsol->newf;
+    return fsol->origin->facs[i-1];
+}
+
+// Checks if two futuresols create the same solution.
+int futuresol_equal(const futuresol *aa, const futuresol *bb){
+    if(aa->hash!=bb->hash) return 0;
+    if(aa->origin->n_facs!=bb->origin->n_facs) return 0;
+    const solution *oa = aa->origin;
+    const solution *ob = bb->origin;
+    if(oa->facs_bits!=NULL && ob->facs_bits!=NULL){
+        // Both are equal if the origins are equal and have the same newf, or if they only differ
+        // in their newfs and each origin has the newf of the other one
+        int diff = bitset_diff(oa->facs_bits,ob->facs_bits,oa->facs_words);
+        if(aa->newf==bb->newf) return diff==0;
+        return diff==2 && bitset_test(oa->facs_bits,bb->newf) && bitset_test(ob->facs_bits,aa->newf);
     }
-    return 0;
+    for(int i=0;i<=aa->origin->n_facs;i++){
+        if(futuresol_fac(aa,i)!=futuresol_fac(bb,i)) return 0;
+    }
+    return 1;
 }
 
 // Inits a futuresol from a current sol and a new facility
@@ -33,61 +47,219 @@ int futuresol_init_from(futuresol *fsol, solution *sol, int newf){
     assert(sol!=NULL);
     fsol->origin = sol;
     fsol->newf = newf;
-    fsol->n_facs = sol->n_facs;
-    // Copy facilitites, check if f already exists, init hash.
-    fsol -> hash = hash_int(newf);
-    for(int k=0;k<sol->n_facs;k++){
-        if(sol->facs[k]==newf) return 0; // If the solution candidate is not new // TODO: make faster when sols->nfacs is near n
-        fsol->facs[k] = sol->facs[k];
-        // Include solution on the hash
-        fsol->hash = fsol->hash ^ hash_int(fsol->facs[k]);
-    }
-    // Add the new facility to the inner array
-    add_to_sorted(fsol->facs,&fsol->n_facs,newf);
+    // Check if f already exists
+    fsol->newf_pos = lower_bound_sorted(sol->facs,sol->n_facs,newf);
+    if(fsol->newf_pos<sol->n_facs && sol->facs[fsol->newf_pos]==newf) return 0; // If the solution candidate is not new
+    // The hash of the new solution only needs the new facility
+    fsol->hash = sol->hash ^ hash_fac(newf);
     return 1;
 }
 
+//#############################################################
+// DELETION OF REPEATED FUTURESOLS
+//#############################################################
+
+/* Open addressing hash set of futuresol indexes, filled in parallel with atomic compare and swaps.
+When several futuresols create the same solution, only one of them is kept on its slot,
+depending on the filter, the one with the best or the worst origin. */
+typedef struct {
+    int *table; // -1 on empty slots.
+    uint mask;
+} futureset;
+
+futureset *futureset_init(int n_fsols){
+    futureset *fset = safe_malloc(sizeof(futureset));
+    uint size = 16;
+    while(size<2*(uint)n_fsols) size *= 2;
+    fset->mask = size-1;
+    fset->table = safe_malloc(sizeof(int)*size);
+    memset(fset->table,-1,sizeof(int)*size);
+    return fset;
+}
+
+void futureset_free(futureset *fset){
+    free(fset->table);
+    free(fset);
+}
+
+// If the futuresol a should be kept instead of b, when both create the same solution.
+// Depending on the filter, the new solution should be better that the better (worst) origin that generates it.
+// Ties are broken by index, so the kept futuresol doesn't depend on the order of insertion.
+static inline int futuresol_replaces(const futuresol *futuresols, int a, int b, int keep_best){
+    double value_a = futuresols[a].origin->value;
+    double value_b = futuresols[b].origin->value;
+    if(keep_best) return value_a>value_b || (value_a==value_b && a<b);
+    else          return value_a<value_b || (value_a==value_b && a>b);
+}
+
+// Inserts the futuresol r on the set, replacing an equal one if it should be kept instead.
+void futureset_insert(futureset *fset, const futuresol *futuresols, int r, int keep_best){
+    uint pos = (uint)(futuresols[r].hash & fset->mask);
+    while(1){
+        int cur = __atomic_load_n(&fset->table[pos],__ATOMIC_ACQUIRE);
+        if(cur==-1 || (futuresol_equal(&futuresols[cur],&futuresols[r]) && futuresol_replaces(futuresols,r,cur,keep_best))){
+            // Take the slot, if other thread changed it, check it again
+            if(__atomic_compare_exchange_n(&fset->table[pos],&cur,r,0,__ATOMIC_ACQ_REL,__ATOMIC_ACQUIRE)) return;
+            continue;
+        }
+        // The equal futuresol on the slot is kept
+        if(futuresol_equal(&futuresols[cur],&futuresols[r])) return;
+        pos = (pos+1) & fset->mask;
+    }
+}
+
+typedef struct {
+    int thread_id;
+    int n_threads;
+    int n_fsols;
+    const futuresol *futuresols;
+    futureset *fset;
+    int keep_best;
+} futureset_thread_args;
+
+void *futureset_thread_execution(void *arg){
+    futureset_thread_args *args = (futureset_thread_args *) arg;
+    for(int r=args->thread_id;r<args->n_fsols;r+=args->n_threads){
+        futureset_insert(args->fset,args->futuresols,r,args->keep_best);
+    }
+    return NULL;
+}
+
 //#############################################################
 // GENERATION OF NEW SOLUTIONS FROM FUTURESOLS
 //#############################################################
 
+// A child kept by a thread, when only the best children are kept.
+typedef struct {
+    solution *sol;
+    int r; // Index of its futuresol.
+} keptsol;
+
+// If a child with the given value and futuresol index is better than a kept one.
+// Ties are broken by index, so the kept children are the first ones that a (stable) sort by value would give.
+static inline int keptsol_better(double value, int r, const keptsol *kept){
+    return value>kept->sol->value || (value==kept->sol->value && r<kept->r);
+}
+
+// Moves down the kept child at position i, on a heap with the worst kept child on top.
+static void keptsol_sift_down(keptsol *heap, int n_heap, int i){
+    while(1){
+        int worst = i;
+        int l = 2*i+1, r = 2*i+2;
+        if(l<n_heap && keptsol_better(heap[worst].sol->value,heap[worst].r,&heap[l])) worst = l;
+        if(r<n_heap && keptsol_better(heap[worst].sol->value,heap[worst].r,&heap[r])) worst = r;
+        if(worst==i) return;
+        keptsol aux = heap[i];
+        heap[i] = heap[worst];
+        heap[worst] = aux;
+        i = worst;
+    }
+}
+
+// Adds a kept child to the heap.
+static void keptsol_push(keptsol *heap, int *n_heap, keptsol kept){
+    int i = *n_heap;
+    heap[i] = kept;
+    *n_heap += 1;
+    while(i>0){
+        int parent = (i-1)/2;
+        if(!keptsol_better(heap[parent].sol->value,heap[parent].r,&heap[i])) return;
+        keptsol aux = heap[i];
+        heap[i] = heap[parent];
+        heap[parent] = aux;
+        i = parent;
+    }
+}
+
 typedef struct {
     int thread_id;
     const rundata *run;
     int n_fsols;
-    void *futuresols;
-    size_t fsol_size;
+    futuresol *futuresols;
     solution **out_sols;
+    // If the child of each futuresol passed the filters (even if it wasn't kept).
+    char *passed;
+    // If greater than 0, only the n_best best children of the thread are kept.
+    int n_best;
+    solarena *arena;
+    // Number of children whose value was evaluated before building them, and number of children built.
+    long long int n_evaluated;
+    long long int n_materialized;
 } expand_thread_args;
 
 // Check if a solution passes the value of which it would be filtered.
 // Equal valued solutions are not filtered if the size restriction has not yet ben reached
 // Or if the other value is -INFINITY.
-int is_filtered(const problem *prob, const solution *sol, double other){
-    int not_equality = sol->n_facs<=prob->size_restriction_minimum || other<=-INFINITY;
+// n_facs and value are the ones of the solution.
+int is_filtered(const problem *prob, int n_facs, double value, double other){
+    int not_equality = n_facs<=prob->size_restriction_minimum || other<=-INFINITY;
     if(not_equality){
-        return sol->value < other;
+        return value < other;
     }else{
-        return sol->value <= other;
+        return value <= other;
     }
 }
 
 void *expand_thread_execution(void *arg){
     expand_thread_args *args = (expand_thread_args *) arg;
     const problem *prob = args->run->prob;
+    filter filt = args->run->filter;
 
     // Auxiliary arrays that could be useful
     int *phi2 = NULL;
     double *v = NULL;
 
+    // Heap of the best children, when only them are kept, and solution where the children are built once it is full.
+    keptsol *heap = NULL;
+    int n_heap = 0;
+    solution *scratch = NULL;
+    if(args->n_best>0) heap = safe_malloc(sizeof(keptsol)*args->n_best);
+
+    args->n_evaluated = 0;
+    args->n_materialized = 0;
+
     for(int r=args->thread_id;r<args->n_fsols;r+=args->run->n_threads){
-        // Generate a new solution from the fsol, and then check if it passes filtering.
-        futuresol *fsol = (futuresol *)(args->futuresols+args->fsol_size*r);
-        solution *new_sol = solution_copy(prob,fsol->origin);
+        futuresol *fsol = &args->futuresols[r];
+        int new_n_facs = fsol->origin->n_facs+1;
+        args->out_sols[r] = NULL;
+        args->passed[r] = 0;
+        int heap_full = args->n_best>0 && n_heap==args->n_best;
+        // Filters that use fsol->origin only need the value of the new solution, so it is
+        // computed before building it, to only build the ones that pass the filter.
+        // The same is done for the other filters when the heap is full, to only build the children that would be kept.
+        // Notice that if the filter is BETTER_THAN_ONE_PARENT, then fsol->origin is the worst parent
+        // If it is BETTER_THAN_ALL_PARENTS, then fsol->origin is the best parent
+        if(filt==BETTER_THAN_ONE_PARENT || filt==BETTER_THAN_ALL_PARENTS
+                || (heap_full && filt<BETTER_THAN_SUBSETS)){
+            double new_value = solution_value_after_add(prob,fsol->origin,fsol->newf);
+            args->n_evaluated += 1;
+            int filtered = 0;
+            if(filt==BETTER_THAN_ONE_PARENT || filt==BETTER_THAN_ALL_PARENTS){
+                filtered = is_filtered(prob,new_n_facs,new_value,fsol->origin->value);
+            }else if(filt==BETTER_THAN_EMPTY){
+                filtered = is_filtered(prob,new_n_facs,new_value,-INFINITY);
+            }
+            if(filtered) continue;
+            // Passes all the filters but wouldn't be kept
+            if(heap_full && !keptsol_better(new_value,r,&heap[0])){
+                args->passed[r] = 1;
+                continue;
+            }
+        }
+        // Generate a new solution from the fsol, and then check if it passes the remaining filters.
+        solution *new_sol;
+        if(heap_full){
+            if(scratch==NULL) scratch = solarena_copy(args->arena,args->thread_id,prob,fsol->origin);
+            else solarena_overwrite(args->arena,prob,scratch,fsol->origin);
+            new_sol = scratch;
+        }else{
+            new_sol = solarena_copy(args->arena,args->thread_id,prob,fsol->origin);
+        }
         solution_add(prob,new_sol,fsol->newf,NULL);
+        args->n_materialized += 1;
         int filtered = 0;
         // Must be better than any other subset (minus 1 facility)
-        if(args->run->filter >= BETTER_THAN_SUBSETS){
+        if(filt >= BETTER_THAN_SUBSETS){
             // Initialize useful arrays if they aren't already
             if(v==NULL){
                 v = safe_malloc(sizeof(double)*prob->n_facs);
@@ -102,27 +274,37 @@ void *expand_thread_execution(void *arg){
             int f_rem;
             double delta_profit,delta_profit_worem;
             solution_findout(prob,new_sol,-1,v,phi2,NULL,&f_rem,&delta_profit,&delta_profit_worem);
-            filtered = is_filtered(prob,new_sol,new_sol->value+delta_profit);
-        }
-        // Filters that use fsol->origin
-        // Notice that if the filter is BETTER_THAN_ONE_PARENT, then fsol->origin is the worst parent
-        // If it is BETTER_THAN_ALL_PARENTS, then fsol->origin is the best parent
-        else if(args->run->filter >= BETTER_THAN_ONE_PARENT){
-            filtered = is_filtered(prob,new_sol,fsol->origin->value);
+            filtered = is_filtered(prob,new_sol->n_facs,new_sol->value,new_sol->value+delta_profit);
         }
         // If it must be better than the empty solution
-        else if(args->run->filter == BETTER_THAN_EMPTY){
-            filtered = is_filtered(prob,new_sol,-INFINITY);
+        else if(filt == BETTER_THAN_EMPTY){
+            filtered = is_filtered(prob,new_sol->n_facs,new_sol->value,-INFINITY);
         }
-        // Delete the solution
         if(filtered){
-            solution_free(new_sol);
-            args->out_sols[r] = NULL;
-        }else{
+            // Delete the solution, releasing its slot on the arena
+            if(new_sol!=scratch) solarena_pop(args->arena,args->thread_id,new_sol);
+            continue;
+        }
+        args->passed[r] = 1;
+        // The sketch only changes on the reassigned clients
+        if(args->run->precomp->sketch_size>0) solution_sketch_update(args->run,new_sol,fsol->origin);
+        if(args->n_best==0){
             args->out_sols[r] = new_sol;
+        }else if(!heap_full){
+            keptsol kept = {new_sol,r};
+            keptsol_push(heap,&n_heap,kept);
+        }else if(keptsol_better(new_sol->value,r,&heap[0])){
+            // Replace the worst kept child, its solution is reused to build the next children
+            scratch = heap[0].sol;
+            heap[0].sol = new_sol;
+            heap[0].r = r;
+            keptsol_sift_down(heap,n_heap,0);
         }
     }
+    // Output the kept children
+    for(int i=0;i<n_heap;i++) args->out_sols[heap[i].r] = heap[i].sol;
     // Free auxilary arrays if they were allocated
+    if(heap!=NULL) free(heap);
     if(v!=NULL) free(v);
     if(phi2!=NULL) free(phi2);
     //
@@ -134,12 +316,10 @@ void *expand_thread_execution(void *arg){
 //#############################################################
 
 solution **new_expand_solutions(const rundata *run,
-        solution **sols, int n_sols, int *out_n_sols, int pool_size){
+        solution **sols, int n_sols, int *out_n_sols, int *out_n_children, int pool_size, int n_best, solarena *arena){
     const problem *prob = run->prob;
     // Get the corrent size of the solutions on this expansion:
     int current_size = n_sols>0? sols[0]->n_facs : 0;
-    // Compute the size of each futuresol (flexible array member must be added):
-    size_t fsol_size = sizeof(futuresol)+sizeof(int)*(current_size+1);
 
     // ==== Generate futuresols depending on the branching factor
     assert(run->branching_factor>=-1);
@@ -170,7 +350,7 @@ solution **new_expand_solutions(const rundata *run,
     if(branching>(prob->n_facs-current_size)) branching = prob->n_facs-current_size;
 
     // Allocate enough memory for the maximium amount of futuresols that can appear:
-    void *futuresols = safe_malloc(fsol_size*(n_sols*branching+1));
+    futuresol *futuresols = safe_malloc(sizeof(futuresol)*(n_sols*branching+1));
     int n_futuresols = 0;
 
     // Get the candidates to future solutions
@@ -179,8 +359,7 @@ solution **new_expand_solutions(const rundata *run,
         for(int i=0;i<n_sols;i++){
             assert(sols[i]->n_facs==current_size); // All solutions are expected to have the same size.
             for(int f=0;f<prob->n_facs;f++){
-                futuresol *fsol = (futuresol *)(futuresols+fsol_size*n_futuresols);
-                n_futuresols += futuresol_init_from(fsol,sols[i],f);
+                n_futuresols += futuresol_init_from(&futuresols[n_futuresols],sols[i],f);
             }
         }
     }else{
@@ -191,8 +370,7 @@ solution **new_expand_solutions(const rundata *run,
             int n_childs = 0;
             while(n_childs<branching){
                 int f = (int) shuffler_next(shuf);
-                futuresol *fsol = (futuresol *)(futuresols+fsol_size*n_futuresols);
-                int new_found = futuresol_init_from(fsol,sols[i],f);
+                int new_found = futuresol_init_from(&futuresols[n_futuresols],sols[i],f);
                 n_childs     += new_found;
                 n_futuresols += new_found;
             }
@@ -200,38 +378,46 @@ solution **new_expand_solutions(const rundata *run,
         shuffler_free(shuf);
     }
 
-    { // Sort the futuresols in order to detect the similar ones faster:
-        qsort(futuresols,n_futuresols,fsol_size,futuresol_cmp);
+    { // Delete repeated futuresols, inserting them on a hash set [in parallel]
+        futureset *fset = futureset_init(n_futuresols);
+        futureset_thread_args *targs = safe_malloc(sizeof(futureset_thread_args)*run->n_threads);
+        for(int i=0;i<run->n_threads;i++){
+            targs[i].thread_id = i;
+            targs[i].n_threads = run->n_threads;
+            targs[i].n_fsols = n_futuresols;
+            targs[i].futuresols = futuresols;
+            targs[i].fset = fset;
+            targs[i].keep_best = run->filter>=BETTER_THAN_ALL_PARENTS;
+        }
+        threadpool_execute(run->pool,futureset_thread_execution,targs,sizeof(futureset_thread_args));
+        free(targs);
+        // Keep the futuresols on the set, in the order they were generated
+        char *kept = safe_malloc(sizeof(char)*(n_futuresols+1));
+        memset(kept,0,sizeof(char)*(n_futuresols+1));
+        for(uint pos=0;pos<=fset->mask;pos++){
+            if(fset->table[pos]!=-1) kept[fset->table[pos]] = 1;
+        }
+        futureset_free(fset);
         int n_futuresols2 = 0;
-        if(n_futuresols>0){
-            futuresol *last_fsol = (futuresol *)(futuresols);
-            n_futuresols2 = 1;
-            for(int r=1;r<n_futuresols;r++){
-                futuresol *fsol = (futuresol *)(futuresols+fsol_size*r);
-                // Compare fsol with the last_fsol:
-                int ftsol_cmp = futuresol_cmp(last_fsol,fsol);
-                // Check if fsol creates a brave new solution.
-                if(ftsol_cmp!=0){
-                    futuresol *next_pos = (futuresol *)(futuresols+fsol_size*n_futuresols2);
-                    memmove(next_pos,fsol,fsol_size);
-                    last_fsol = next_pos;
-                    n_futuresols2 += 1;
-                }else{
-                    /* If fsol doesn't create a new solution but creates it from a better (worst) one, in that case fsol replaces last_fsol.
-                    Because, depending on the filter, the new solution should be better that the better (worst) one that generates it. */
-                    int is_better = fsol->origin->value>last_fsol->origin->value;
-                    if((run->filter>=BETTER_THAN_ALL_PARENTS) == is_better){
-                        memmove(last_fsol,fsol,fsol_size);
-                    }
-                }
+        for(int r=0;r<n_futuresols;r++){
+            if(kept[r]){
+                futuresols[n_futuresols2] = futuresols[r];
+                n_futuresols2 += 1;
             }
         }
+        free(kept);
         // Update the futuresols, and realloc to reduce memory usage
         n_futuresols = n_futuresols2;
-        futuresols = safe_realloc(futuresols,fsol_size*n_futuresols);
+        futuresols = safe_realloc(futuresols,sizeof(futuresol)*n_futuresols);
     }
 
     solution **out_sols = safe_malloc(sizeof(solution*)*n_futuresols);
+    char *passed = safe_malloc(sizeof(char)*n_futuresols);
+    // No thread can keep more children than the ones it builds
+    int thread_n_fsols = (n_futuresols+run->n_threads-1)/run->n_threads;
+    if(n_best>thread_n_fsols) n_best = thread_n_fsols;
+    struct timeval expansion_start;
+    gettimeofday(&expansion_start,NULL);
     { // Create new solutions [in parallel]
         expand_thread_args *targs = safe_malloc(sizeof(expand_thread_args)*run->n_threads);
         for(int i=0;i<run->n_threads;i++){
@@ -239,45 +425,49 @@ solution **new_expand_solutions(const rundata *run,
             targs[i].run = run;
             targs[i].n_fsols = n_futuresols;
             targs[i].futuresols = futuresols;
-            targs[i].fsol_size = fsol_size;
             targs[i].out_sols = out_sols;
+            targs[i].passed = passed;
+            targs[i].n_best = n_best;
+            targs[i].arena = arena;
         }
-        // Generate threads in order to expand the solutions
-        pthread_t *threads = safe_malloc(sizeof(pthread_t)*run->n_threads);
+        // Expand the solutions on the threads
+        threadpool_execute(run->pool,expand_thread_execution,targs,sizeof(expand_thread_args));
+        // Add the counters of each thread
         for(int i=0;i<run->n_threads;i++){
-            int rc = pthread_create(&threads[i],NULL,expand_thread_execution,&targs[i]);
-            if(rc){
-                fprintf(stderr,"Error %d on thread creation\n",rc);
-                exit(1);
-            }
-        }
-        // Join threads
-        for(int i=0;i<run->n_threads;i++){
-            pthread_join(threads[i],NULL);
+            run->run_inf->n_children_evaluated    += targs[i].n_evaluated;
+            run->run_inf->n_children_materialized += targs[i].n_materialized;
         }
         //
-        free(threads);
         free(targs);
     }
+    struct timeval expansion_end;
+    gettimeofday(&expansion_end,NULL);
+    run->run_inf->expansion_seconds += (expansion_end.tv_sec-expansion_start.tv_sec)
+        + 1e-6*(expansion_end.tv_usec-expansion_start.tv_usec);
 
     // Set the terminal flag for the original solutions (revert with futuresols origins)
     for(int i=0;i<n_sols;i++) sols[i]->terminal = 1;
 
     { // Eliminate NULLed out solutions
         int n_sols = 0;
+        int n_children = 0;
         for(int r=0;r<n_futuresols;r++){
+            if(passed[r]){
+                futuresols[r].origin->terminal = 0; // origin is not terminal because it had a child.
+                n_children += 1;
+            }
             if(out_sols[r]!=NULL){
-                futuresol *fsol = (futuresol *)(futuresols+fsol_size*r);
-                fsol->origin->terminal = 0; // origin is not terminal because it had a child.
                 out_sols[n_sols] = out_sols[r];
                 n_sols += 1;
             }
         }
         out_sols = safe_realloc(out_sols,sizeof(solution*)*(n_sols));
         *out_n_sols = n_sols;
+        *out_n_children = n_children;
     }
 
 
+    free(passed);
     free(futuresols);
     return out_sols;
 }
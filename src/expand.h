@@ -4,8 +4,13 @@
 #include "utils.h"
 #include "solution.h"
 #include "shuffle.h"
+#include "solarena.h"
 
+// Creates the next generation of solutions from the given ones, the new solutions are created on the arena.
+// If n_best is greater than 0, each thread only keeps its n_best best children (by value, the first ones on ties),
+// so the n_best best of them are the same that reduction_bests would pick from all the children.
+// out_n_children is set to the number of children that passed the filters, even if they weren't kept.
 solution **new_expand_solutions(const rundata *run,
-        solution **sols, int n_sols, int *out_n_sols, int pool_size);
+        solution **sols, int n_sols, int *out_n_sols, int *out_n_children, int pool_size, int n_best, solarena *arena);
 
 #endif
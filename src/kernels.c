@@ -0,0 +1,491 @@
+#include "kernels.h"
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+    #include <immintrin.h>
+#endif
+
+/* The changes on the costs are accumulated on KERNEL_SUM_LANES partial sums of doubles, that are
+packed on the vectorized versions, without branches. The packed compare also gives the clients
+that improve, as only a few of them do after the first facilities are added, they are reassigned
+on a scalar loop over the mask bits. */
+
+#if defined(__AVX512F__)
+    // Loads 8 costs as doubles
+    #ifdef COST_FLOAT
+        #define KERNEL_LOAD8(ptr) _mm512_cvtps_pd(_mm256_loadu_ps(ptr))
+    #else
+        #define KERNEL_LOAD8(ptr) _mm512_loadu_pd(ptr)
+    #endif
+#elif defined(__AVX2__)
+    // Loads 4 costs as doubles
+    #ifdef COST_FLOAT
+        #define KERNEL_LOAD4(ptr) _mm256_cvtps_pd(_mm_loadu_ps(ptr))
+    #else
+        #define KERNEL_LOAD4(ptr) _mm256_loadu_pd(ptr)
+    #endif
+#endif
+
+// Adds the changes on the costs of clients c0 to n_clis-1 to the partial sums, reassigning them if assigns isn't NULL.
+static inline void kernel_add_scalar(int c0, int n_clis, const costval *row, costval *costs, facidx *assigns, int f,
+        double *partial){
+    for(int c=c0;c<n_clis;c++){
+        if(row[c]<costs[c]){
+            partial[c%KERNEL_SUM_LANES] += (double)row[c]-(double)costs[c];
+            if(assigns!=NULL){
+                costs[c] = row[c];
+                assigns[c] = f;
+            }
+        }
+    }
+}
+
+// Returns the change on the costs of all the clients, reassigning them if assigns isn't NULL.
+static inline double kernel_add(int n_clis, const costval *row, costval *costs, facidx *assigns, int f){
+    double partial[KERNEL_SUM_LANES] = {0};
+    int c = 0;
+    #if defined(__AVX512F__)
+        __m512d acc = _mm512_setzero_pd();
+        for(;c+8<=n_clis;c+=8){
+            __m512d vrow   = KERNEL_LOAD8(&row[c]);
+            __m512d vcosts = KERNEL_LOAD8(&costs[c]);
+            __mmask8 lt = _mm512_cmp_pd_mask(vrow,vcosts,_CMP_LT_OQ);
+            acc = _mm512_mask_add_pd(acc,lt,acc,_mm512_sub_pd(vrow,vcosts));
+            if(assigns==NULL) continue;
+            uint mask = lt;
+            while(mask){
+                int k = c+__builtin_ctz(mask);
+                costs[k] = row[k];
+                assigns[k] = f;
+                mask &= mask-1;
+            }
+        }
+        _mm512_storeu_pd(partial,acc);
+    #elif defined(__AVX2__)
+        __m256d acc_lo = _mm256_setzero_pd();
+        __m256d acc_hi = _mm256_setzero_pd();
+        for(;c+8<=n_clis;c+=8){
+            __m256d vrow_lo   = KERNEL_LOAD4(&row[c]);
+            __m256d vcosts_lo = KERNEL_LOAD4(&costs[c]);
+            __m256d vrow_hi   = KERNEL_LOAD4(&row[c+4]);
+            __m256d vcosts_hi = KERNEL_LOAD4(&costs[c+4]);
+            __m256d lt_lo = _mm256_cmp_pd(vrow_lo,vcosts_lo,_CMP_LT_OQ);
+            __m256d lt_hi = _mm256_cmp_pd(vrow_hi,vcosts_hi,_CMP_LT_OQ);
+            acc_lo = _mm256_add_pd(acc_lo,_mm256_and_pd(lt_lo,_mm256_sub_pd(vrow_lo,vcosts_lo)));
+            acc_hi = _mm256_add_pd(acc_hi,_mm256_and_pd(lt_hi,_mm256_sub_pd(vrow_hi,vcosts_hi)));
+            if(assigns==NULL) continue;
+            uint mask = _mm256_movemask_pd(lt_lo) | (_mm256_movemask_pd(lt_hi)<<4);
+            while(mask){
+                int k = c+__builtin_ctz(mask);
+                costs[k] = row[k];
+                assigns[k] = f;
+                mask &= mask-1;
+            }
+        }
+        _mm256_storeu_pd(&partial[0],acc_lo);
+        _mm256_storeu_pd(&partial[4],acc_hi);
+    #endif
+    // Remaining clients (all of them on the scalar version)
+    kernel_add_scalar(c,n_clis,row,costs,assigns,f,partial);
+    return kernel_sum_lanes(partial);
+}
+
+double kernel_add_sweep_scalar(int n_clis, const costval *row, costval *costs, facidx *assigns, int f){
+    double partial[KERNEL_SUM_LANES] = {0};
+    kernel_add_scalar(0,n_clis,row,costs,assigns,f,partial);
+    return kernel_sum_lanes(partial);
+}
+
+double kernel_add_sweep(int n_clis, const costval *row, costval *costs, facidx *assigns, int f){
+    assert(assigns!=NULL);
+    return kernel_add(n_clis,row,costs,assigns,f);
+}
+
+double kernel_add_delta(int n_clis, const costval *row, const costval *costs){
+    // costs isn't modified when assigns is NULL
+    return kernel_add(n_clis,row,(costval *)costs,NULL,-1);
+}
+
+/* The L1 distance, facility rows and sketch kernels are used on builds without -march=native too, so their vectorized versions
+are compiled for their instruction set with target attributes and the ones to use are chosen at runtime, the first
+time that one of them is called. The results are accumulated on KERNEL_SUM_LANES partial sums as on the add sweep
+kernels, and the sketch kernel uses the same fused multiply-adds on all the versions. */
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define KERNEL_L1_DISPATCH
+    #include <immintrin.h>
+#endif
+
+// Adds the absolute differences of clients c0 to n_clis-1 to the partial sums.
+static inline void kernel_l1_scalar_lanes(int c0, int n_clis, const costval *a, const costval *b, double *partial){
+    for(int c=c0;c<n_clis;c++){
+        double delta = (double)a[c]-(double)b[c];
+        partial[c%KERNEL_SUM_LANES] += delta<0? -delta : delta;
+    }
+}
+
+double kernel_l1_distance_scalar(int n_clis, const costval *a, const costval *b){
+    double partial[KERNEL_SUM_LANES] = {0};
+    kernel_l1_scalar_lanes(0,n_clis,a,b,partial);
+    return kernel_sum_lanes(partial);
+}
+
+#ifdef KERNEL_L1_DISPATCH
+
+__attribute__((target("avx2")))
+static double kernel_l1_distance_avx2(int n_clis, const costval *a, const costval *b){
+    double partial[KERNEL_SUM_LANES] = {0};
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    __m256d acc_lo = _mm256_setzero_pd();
+    __m256d acc_hi = _mm256_setzero_pd();
+    int c = 0;
+    for(;c+8<=n_clis;c+=8){
+        #ifdef COST_FLOAT
+            __m256d va_lo = _mm256_cvtps_pd(_mm_loadu_ps(&a[c]));
+            __m256d vb_lo = _mm256_cvtps_pd(_mm_loadu_ps(&b[c]));
+            __m256d va_hi = _mm256_cvtps_pd(_mm_loadu_ps(&a[c+4]));
+            __m256d vb_hi = _mm256_cvtps_pd(_mm_loadu_ps(&b[c+4]));
+        #else
+            __m256d va_lo = _mm256_loadu_pd(&a[c]);
+            __m256d vb_lo = _mm256_loadu_pd(&b[c]);
+            __m256d va_hi = _mm256_loadu_pd(&a[c+4]);
+            __m256d vb_hi = _mm256_loadu_pd(&b[c+4]);
+        #endif
+        acc_lo = _mm256_add_pd(acc_lo,_mm256_andnot_pd(sign,_mm256_sub_pd(va_lo,vb_lo)));
+        acc_hi = _mm256_add_pd(acc_hi,_mm256_andnot_pd(sign,_mm256_sub_pd(va_hi,vb_hi)));
+    }
+    _mm256_storeu_pd(&partial[0],acc_lo);
+    _mm256_storeu_pd(&partial[4],acc_hi);
+    kernel_l1_scalar_lanes(c,n_clis,a,b,partial);
+    return kernel_sum_lanes(partial);
+}
+
+__attribute__((target("avx512f")))
+static double kernel_l1_distance_avx512(int n_clis, const costval *a, const costval *b){
+    double partial[KERNEL_SUM_LANES] = {0};
+    __m512d acc = _mm512_setzero_pd();
+    int c = 0;
+    for(;c+8<=n_clis;c+=8){
+        #ifdef COST_FLOAT
+            __m512d va = _mm512_cvtps_pd(_mm256_loadu_ps(&a[c]));
+            __m512d vb = _mm512_cvtps_pd(_mm256_loadu_ps(&b[c]));
+        #else
+            __m512d va = _mm512_loadu_pd(&a[c]);
+            __m512d vb = _mm512_loadu_pd(&b[c]);
+        #endif
+        acc = _mm512_add_pd(acc,_mm512_abs_pd(_mm512_sub_pd(va,vb)));
+    }
+    _mm512_storeu_pd(partial,acc);
+    kernel_l1_scalar_lanes(c,n_clis,a,b,partial);
+    return kernel_sum_lanes(partial);
+}
+
+#endif
+
+void kernel_l1_rows_scalar(int n_clis, const costval *a, const costval *const *b, double *partial){
+    for(int r=0;r<KERNEL_ROWS;r++) kernel_l1_scalar_lanes(0,n_clis,a,b[r],&partial[r*KERNEL_SUM_LANES]);
+}
+
+// Minimum of a[c]+b[c] for clients c0 to n_clis-1 and m.
+static inline costval kernel_min_sum_scalar_from(int c0, int n_clis, const costval *a, const costval *b, costval m){
+    for(int c=c0;c<n_clis;c++){
+        costval sum = a[c]+b[c];
+        if(sum<m) m = sum;
+    }
+    return m;
+}
+
+void kernel_min_sum_rows_scalar(int n_clis, const costval *a, const costval *const *b, double *mins){
+    for(int r=0;r<KERNEL_ROWS;r++) mins[r] = kernel_min_sum_scalar_from(0,n_clis,a,b[r],mins[r]);
+}
+
+#ifdef KERNEL_L1_DISPATCH
+
+// The rows kernels keep an accumulator for each row, so that they don't wait for each other.
+
+__attribute__((target("avx2")))
+static void kernel_l1_rows_avx2(int n_clis, const costval *a, const costval *const *b, double *partial){
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    __m256d acc_lo[KERNEL_ROWS], acc_hi[KERNEL_ROWS];
+    for(int r=0;r<KERNEL_ROWS;r++){
+        acc_lo[r] = _mm256_loadu_pd(&partial[r*KERNEL_SUM_LANES]);
+        acc_hi[r] = _mm256_loadu_pd(&partial[r*KERNEL_SUM_LANES+4]);
+    }
+    int c = 0;
+    for(;c+8<=n_clis;c+=8){
+        #ifdef COST_FLOAT
+            __m256d va_lo = _mm256_cvtps_pd(_mm_loadu_ps(&a[c]));
+            __m256d va_hi = _mm256_cvtps_pd(_mm_loadu_ps(&a[c+4]));
+        #else
+            __m256d va_lo = _mm256_loadu_pd(&a[c]);
+            __m256d va_hi = _mm256_loadu_pd(&a[c+4]);
+        #endif
+        for(int r=0;r<KERNEL_ROWS;r++){
+            #ifdef COST_FLOAT
+                __m256d vb_lo = _mm256_cvtps_pd(_mm_loadu_ps(&b[r][c]));
+                __m256d vb_hi = _mm256_cvtps_pd(_mm_loadu_ps(&b[r][c+4]));
+            #else
+                __m256d vb_lo = _mm256_loadu_pd(&b[r][c]);
+                __m256d vb_hi = _mm256_loadu_pd(&b[r][c+4]);
+            #endif
+            acc_lo[r] = _mm256_add_pd(acc_lo[r],_mm256_andnot_pd(sign,_mm256_sub_pd(va_lo,vb_lo)));
+            acc_hi[r] = _mm256_add_pd(acc_hi[r],_mm256_andnot_pd(sign,_mm256_sub_pd(va_hi,vb_hi)));
+        }
+    }
+    for(int r=0;r<KERNEL_ROWS;r++){
+        _mm256_storeu_pd(&partial[r*KERNEL_SUM_LANES],acc_lo[r]);
+        _mm256_storeu_pd(&partial[r*KERNEL_SUM_LANES+4],acc_hi[r]);
+        kernel_l1_scalar_lanes(c,n_clis,a,b[r],&partial[r*KERNEL_SUM_LANES]);
+    }
+}
+
+__attribute__((target("avx512f")))
+static void kernel_l1_rows_avx512(int n_clis, const costval *a, const costval *const *b, double *partial){
+    __m512d acc[KERNEL_ROWS];
+    for(int r=0;r<KERNEL_ROWS;r++) acc[r] = _mm512_loadu_pd(&partial[r*KERNEL_SUM_LANES]);
+    int c = 0;
+    for(;c+8<=n_clis;c+=8){
+        #ifdef COST_FLOAT
+            __m512d va = _mm512_cvtps_pd(_mm256_loadu_ps(&a[c]));
+        #else
+            __m512d va = _mm512_loadu_pd(&a[c]);
+        #endif
+        for(int r=0;r<KERNEL_ROWS;r++){
+            #ifdef COST_FLOAT
+                __m512d vb = _mm512_cvtps_pd(_mm256_loadu_ps(&b[r][c]));
+            #else
+                __m512d vb = _mm512_loadu_pd(&b[r][c]);
+            #endif
+            acc[r] = _mm512_add_pd(acc[r],_mm512_abs_pd(_mm512_sub_pd(va,vb)));
+        }
+    }
+    for(int r=0;r<KERNEL_ROWS;r++){
+        _mm512_storeu_pd(&partial[r*KERNEL_SUM_LANES],acc[r]);
+        kernel_l1_scalar_lanes(c,n_clis,a,b[r],&partial[r*KERNEL_SUM_LANES]);
+    }
+}
+
+// The sums are done on costval as on the scalar version, and the minimum doesn't depend on the order.
+__attribute__((target("avx2")))
+static void kernel_min_sum_rows_avx2(int n_clis, const costval *a, const costval *const *b, double *mins){
+    int c = 0;
+    #ifdef COST_FLOAT
+        __m256 acc[KERNEL_ROWS];
+        for(int r=0;r<KERNEL_ROWS;r++) acc[r] = _mm256_set1_ps(INFINITY);
+        for(;c+8<=n_clis;c+=8){
+            __m256 va = _mm256_loadu_ps(&a[c]);
+            for(int r=0;r<KERNEL_ROWS;r++) acc[r] = _mm256_min_ps(acc[r],_mm256_add_ps(va,_mm256_loadu_ps(&b[r][c])));
+        }
+        int n_lanes = 8;
+        float lanes[8];
+    #else
+        __m256d acc[KERNEL_ROWS];
+        for(int r=0;r<KERNEL_ROWS;r++) acc[r] = _mm256_set1_pd(INFINITY);
+        for(;c+4<=n_clis;c+=4){
+            __m256d va = _mm256_loadu_pd(&a[c]);
+            for(int r=0;r<KERNEL_ROWS;r++) acc[r] = _mm256_min_pd(acc[r],_mm256_add_pd(va,_mm256_loadu_pd(&b[r][c])));
+        }
+        int n_lanes = 4;
+        double lanes[4];
+    #endif
+    for(int r=0;r<KERNEL_ROWS;r++){
+        #ifdef COST_FLOAT
+            _mm256_storeu_ps(lanes,acc[r]);
+        #else
+            _mm256_storeu_pd(lanes,acc[r]);
+        #endif
+        costval m = kernel_min_sum_scalar_from(c,n_clis,a,b[r],INFINITY);
+        for(int l=0;l<n_lanes;l++) if(lanes[l]<m) m = lanes[l];
+        if(m<mins[r]) mins[r] = m;
+    }
+}
+
+__attribute__((target("avx512f")))
+static void kernel_min_sum_rows_avx512(int n_clis, const costval *a, const costval *const *b, double *mins){
+    int c = 0;
+    #ifdef COST_FLOAT
+        __m512 acc[KERNEL_ROWS];
+        for(int r=0;r<KERNEL_ROWS;r++) acc[r] = _mm512_set1_ps(INFINITY);
+        for(;c+16<=n_clis;c+=16){
+            __m512 va = _mm512_loadu_ps(&a[c]);
+            for(int r=0;r<KERNEL_ROWS;r++) acc[r] = _mm512_min_ps(acc[r],_mm512_add_ps(va,_mm512_loadu_ps(&b[r][c])));
+        }
+        for(int r=0;r<KERNEL_ROWS;r++){
+            costval m = kernel_min_sum_scalar_from(c,n_clis,a,b[r],_mm512_reduce_min_ps(acc[r]));
+            if(m<mins[r]) mins[r] = m;
+        }
+    #else
+        __m512d acc[KERNEL_ROWS];
+        for(int r=0;r<KERNEL_ROWS;r++) acc[r] = _mm512_set1_pd(INFINITY);
+        for(;c+8<=n_clis;c+=8){
+            __m512d va = _mm512_loadu_pd(&a[c]);
+            for(int r=0;r<KERNEL_ROWS;r++) acc[r] = _mm512_min_pd(acc[r],_mm512_add_pd(va,_mm512_loadu_pd(&b[r][c])));
+        }
+        for(int r=0;r<KERNEL_ROWS;r++){
+            costval m = kernel_min_sum_scalar_from(c,n_clis,a,b[r],_mm512_reduce_min_pd(acc[r]));
+            if(m<mins[r]) mins[r] = m;
+        }
+    #endif
+}
+
+#endif
+
+// Constants of the logarithm on the sketch kernel:
+// log2(x) = exponent + 2/ln(2) atanh(s), s = (mantissa-1)/(mantissa+1) on [0,1/3), using the series of atanh up to s^7.
+#define KERNEL_LOG2_SCALE 2.8853900817779268
+#define KERNEL_EXP_MAGIC 4503599627370496.0 // 2^52, to convert the exponent bits to a double.
+
+// Adds log2|a[i]-b[i]| of projections i0 to n-1 to the partial sums (-1023 when they are equal).
+static inline void kernel_log2_scalar_lanes(int i0, int n, const double *a, const double *b, double *partial){
+    for(int i=i0;i<n;i++){
+        double delta = fabs(a[i]-b[i]);
+        uint64_t bits;
+        memcpy(&bits,&delta,sizeof(double));
+        double exponent = (double)(int64_t)(bits>>52)-1023;
+        bits = (bits&0x000fffffffffffffULL)|0x3ff0000000000000ULL;
+        double mantissa;
+        memcpy(&mantissa,&bits,sizeof(double));
+        double s = (mantissa-1)/(mantissa+1);
+        double s2 = s*s;
+        double poly = fma(s2,1.0/7,1.0/5);
+        poly = fma(s2,poly,1.0/3);
+        poly = fma(s2,poly,1.0);
+        partial[i%KERNEL_SUM_LANES] += fma(KERNEL_LOG2_SCALE,s*poly,exponent);
+    }
+}
+
+double kernel_log2_delta_sum_scalar(int n, const double *a, const double *b){
+    double partial[KERNEL_SUM_LANES] = {0};
+    kernel_log2_scalar_lanes(0,n,a,b,partial);
+    return kernel_sum_lanes(partial);
+}
+
+#ifdef KERNEL_L1_DISPATCH
+
+__attribute__((target("avx2,fma")))
+static inline __m256d kernel_log2_delta_avx2(__m256d va, __m256d vb){
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    const __m256d one = _mm256_set1_pd(1.0);
+    __m256i bits = _mm256_castpd_si256(_mm256_andnot_pd(sign,_mm256_sub_pd(va,vb)));
+    // The exponent bits on the mantissa of 2^52 give 2^52+exponent
+    __m256i ebits = _mm256_or_si256(_mm256_srli_epi64(bits,52),_mm256_set1_epi64x(0x4330000000000000LL));
+    __m256d exponent = _mm256_sub_pd(_mm256_castsi256_pd(ebits),_mm256_set1_pd(KERNEL_EXP_MAGIC+1023));
+    __m256i mbits = _mm256_or_si256(_mm256_and_si256(bits,_mm256_set1_epi64x(0x000fffffffffffffLL)),
+        _mm256_set1_epi64x(0x3ff0000000000000LL));
+    __m256d mantissa = _mm256_castsi256_pd(mbits);
+    __m256d s = _mm256_div_pd(_mm256_sub_pd(mantissa,one),_mm256_add_pd(mantissa,one));
+    __m256d s2 = _mm256_mul_pd(s,s);
+    __m256d poly = _mm256_fmadd_pd(s2,_mm256_set1_pd(1.0/7),_mm256_set1_pd(1.0/5));
+    poly = _mm256_fmadd_pd(s2,poly,_mm256_set1_pd(1.0/3));
+    poly = _mm256_fmadd_pd(s2,poly,one);
+    return _mm256_fmadd_pd(_mm256_set1_pd(KERNEL_LOG2_SCALE),_mm256_mul_pd(s,poly),exponent);
+}
+
+__attribute__((target("avx2,fma")))
+static double kernel_log2_delta_sum_avx2(int n, const double *a, const double *b){
+    double partial[KERNEL_SUM_LANES] = {0};
+    __m256d acc_lo = _mm256_setzero_pd();
+    __m256d acc_hi = _mm256_setzero_pd();
+    int i = 0;
+    for(;i+8<=n;i+=8){
+        acc_lo = _mm256_add_pd(acc_lo,kernel_log2_delta_avx2(_mm256_loadu_pd(&a[i]),_mm256_loadu_pd(&b[i])));
+        acc_hi = _mm256_add_pd(acc_hi,kernel_log2_delta_avx2(_mm256_loadu_pd(&a[i+4]),_mm256_loadu_pd(&b[i+4])));
+    }
+    _mm256_storeu_pd(&partial[0],acc_lo);
+    _mm256_storeu_pd(&partial[4],acc_hi);
+    kernel_log2_scalar_lanes(i,n,a,b,partial);
+    return kernel_sum_lanes(partial);
+}
+
+__attribute__((target("avx512f")))
+static double kernel_log2_delta_sum_avx512(int n, const double *a, const double *b){
+    double partial[KERNEL_SUM_LANES] = {0};
+    const __m512d one = _mm512_set1_pd(1.0);
+    __m512d acc = _mm512_setzero_pd();
+    int i = 0;
+    for(;i+8<=n;i+=8){
+        __m512i bits = _mm512_castpd_si512(_mm512_abs_pd(_mm512_sub_pd(_mm512_loadu_pd(&a[i]),_mm512_loadu_pd(&b[i]))));
+        __m512i ebits = _mm512_or_si512(_mm512_srli_epi64(bits,52),_mm512_set1_epi64(0x4330000000000000LL));
+        __m512d exponent = _mm512_sub_pd(_mm512_castsi512_pd(ebits),_mm512_set1_pd(KERNEL_EXP_MAGIC+1023));
+        __m512i mbits = _mm512_or_si512(_mm512_and_si512(bits,_mm512_set1_epi64(0x000fffffffffffffLL)),
+            _mm512_set1_epi64(0x3ff0000000000000LL));
+        __m512d mantissa = _mm512_castsi512_pd(mbits);
+        __m512d s = _mm512_div_pd(_mm512_sub_pd(mantissa,one),_mm512_add_pd(mantissa,one));
+        __m512d s2 = _mm512_mul_pd(s,s);
+        __m512d poly = _mm512_fmadd_pd(s2,_mm512_set1_pd(1.0/7),_mm512_set1_pd(1.0/5));
+        poly = _mm512_fmadd_pd(s2,poly,_mm512_set1_pd(1.0/3));
+        poly = _mm512_fmadd_pd(s2,poly,one);
+        acc = _mm512_add_pd(acc,_mm512_fmadd_pd(_mm512_set1_pd(KERNEL_LOG2_SCALE),_mm512_mul_pd(s,poly),exponent));
+    }
+    _mm512_storeu_pd(partial,acc);
+    kernel_log2_scalar_lanes(i,n,a,b,partial);
+    return kernel_sum_lanes(partial);
+}
+
+#endif
+
+typedef double (*kernel_l1_function)(int, const costval *, const costval *);
+typedef double (*kernel_log2_function)(int, const double *, const double *);
+typedef void (*kernel_rows_function)(int, const costval *, const costval *const *, double *);
+
+// Versions of the kernels to use, chosen on the first call to any of them.
+static kernel_l1_function kernel_l1_selected = NULL;
+static kernel_log2_function kernel_log2_selected = NULL;
+static kernel_rows_function kernel_l1_rows_selected = NULL;
+static kernel_rows_function kernel_min_sum_rows_selected = NULL;
+static const char *kernel_selected_isa = NULL;
+
+static void kernel_select(){
+    if(__atomic_load_n(&kernel_selected_isa,__ATOMIC_ACQUIRE)!=NULL) return;
+    // All the threads that get here pick the same versions
+    const char *isa = "scalar";
+    kernel_l1_function l1 = kernel_l1_distance_scalar;
+    kernel_log2_function log2 = kernel_log2_delta_sum_scalar;
+    kernel_rows_function l1_rows = kernel_l1_rows_scalar;
+    kernel_rows_function min_sum_rows = kernel_min_sum_rows_scalar;
+    #ifdef KERNEL_L1_DISPATCH
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx512f")){
+            isa = "avx512";
+            l1 = kernel_l1_distance_avx512;
+            log2 = kernel_log2_delta_sum_avx512;
+            l1_rows = kernel_l1_rows_avx512;
+            min_sum_rows = kernel_min_sum_rows_avx512;
+        }else if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")){
+            isa = "avx2";
+            l1 = kernel_l1_distance_avx2;
+            log2 = kernel_log2_delta_sum_avx2;
+            l1_rows = kernel_l1_rows_avx2;
+            min_sum_rows = kernel_min_sum_rows_avx2;
+        }
+    #endif
+    __atomic_store_n(&kernel_l1_selected,l1,__ATOMIC_RELAXED);
+    __atomic_store_n(&kernel_log2_selected,log2,__ATOMIC_RELAXED);
+    __atomic_store_n(&kernel_l1_rows_selected,l1_rows,__ATOMIC_RELAXED);
+    __atomic_store_n(&kernel_min_sum_rows_selected,min_sum_rows,__ATOMIC_RELAXED);
+    __atomic_store_n(&kernel_selected_isa,isa,__ATOMIC_RELEASE);
+}
+
+double kernel_l1_distance(int n_clis, const costval *a, const costval *b){
+    kernel_select();
+    return __atomic_load_n(&kernel_l1_selected,__ATOMIC_RELAXED)(n_clis,a,b);
+}
+
+double kernel_log2_delta_sum(int n, const double *a, const double *b){
+    kernel_select();
+    return __atomic_load_n(&kernel_log2_selected,__ATOMIC_RELAXED)(n,a,b);
+}
+
+void kernel_l1_rows(int n_clis, const costval *a, const costval *const *b, double *partial){
+    kernel_select();
+    __atomic_load_n(&kernel_l1_rows_selected,__ATOMIC_RELAXED)(n_clis,a,b,partial);
+}
+
+void kernel_min_sum_rows(int n_clis, const costval *a, const costval *const *b, double *mins){
+    kernel_select();
+    __atomic_load_n(&kernel_min_sum_rows_selected,__ATOMIC_RELAXED)(n_clis,a,b,mins);
+}
+
+const char *kernel_l1_isa(){
+    kernel_select();
+    return kernel_selected_isa;
+}
@@ -0,0 +1,77 @@
+#ifndef DC_KERNELS_H
+#define DC_KERNELS_H
+
+#include "utils.h"
+#include "problem.h"
+
+/*
+Vectorized inner loops of the solver.
+The instruction set is chosen at compile time (-march=native on bin/dc),
+when neither AVX-512 nor AVX2 are available the scalar version is used.
+The L1 distance, facility rows and sketch kernels are chosen at runtime instead, from the instruction sets of the processor.
+*/
+
+#if defined(__AVX512F__)
+    #define KERNELS_ISA "avx512"
+#elif defined(__AVX2__)
+    #define KERNELS_ISA "avx2"
+#else
+    #define KERNELS_ISA "scalar"
+#endif
+
+// The kernels sum the change on the cost of client c on partial sum c%KERNEL_SUM_LANES, then add the partial
+// sums in order, so the scalar and vectorized versions (on any ISA) give exactly the same results.
+#define KERNEL_SUM_LANES 8
+
+static inline double kernel_sum_lanes(const double *partial){
+    double total = 0;
+    for(int l=0;l<KERNEL_SUM_LANES;l++) total += partial[l];
+    return total;
+}
+
+// Reassigns to facility f the clients whose cost on row is strictly lower than their current cost on costs,
+// updating costs and assigns. Returns the sum of the (negative) changes on the assignment costs.
+double kernel_add_sweep(int n_clis, const costval *row, costval *costs, facidx *assigns, int f);
+
+// Scalar version of kernel_add_sweep, with the same results.
+double kernel_add_sweep_scalar(int n_clis, const costval *row, costval *costs, facidx *assigns, int f);
+
+// Same result as kernel_add_sweep, but without reassigning the clients.
+double kernel_add_delta(int n_clis, const costval *row, const costval *costs);
+
+// Sum of the absolute differences between a and b, the per client delta dissimilitude of two solutions
+// from their assignment costs.
+double kernel_l1_distance(int n_clis, const costval *a, const costval *b);
+
+// Scalar version of kernel_l1_distance, with the same results.
+double kernel_l1_distance_scalar(int n_clis, const costval *a, const costval *b);
+
+// Number of rows compared at once by the facility rows kernels.
+#define KERNEL_ROWS 4
+
+// Adds the absolute differences between a and each row b[r] (r<KERNEL_ROWS) to the partial sums of the row,
+// partial[r*KERNEL_SUM_LANES+l]. Client c goes to lane c%KERNEL_SUM_LANES as on kernel_l1_distance, so calling it
+// on consecutive chunks of clients that are multiples of KERNEL_SUM_LANES gives the same sums as kernel_l1_distance.
+void kernel_l1_rows(int n_clis, const costval *a, const costval *const *b, double *partial);
+
+// Scalar version of kernel_l1_rows, with the same results.
+void kernel_l1_rows_scalar(int n_clis, const costval *a, const costval *const *b, double *partial);
+
+// Lowers mins[r] to the minimum of a[c]+b[r][c] (added as costval) for each row b[r] (r<KERNEL_ROWS),
+// the min triangle distance between two facilities from their rows.
+void kernel_min_sum_rows(int n_clis, const costval *a, const costval *const *b, double *mins);
+
+// Scalar version of kernel_min_sum_rows, with the same results.
+void kernel_min_sum_rows_scalar(int n_clis, const costval *a, const costval *const *b, double *mins);
+
+// Sum of log2|a[i]-b[i]| (-1023 for equal values), to estimate the per client delta dissimilitude
+// from the sketches of two solutions.
+double kernel_log2_delta_sum(int n, const double *a, const double *b);
+
+// Scalar version of kernel_log2_delta_sum, with the same results.
+double kernel_log2_delta_sum_scalar(int n, const double *a, const double *b);
+
+// Instruction set used by kernel_l1_distance, the facility rows kernels and kernel_log2_delta_sum.
+const char *kernel_l1_isa();
+
+#endif
@@ -1,23 +1,390 @@
 #include "load.h"
+#include "threadpool.h"
 
-problem *load_simple_format(FILE *fp){
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Rounds an offset of the binary format up to a multiple of PROBLEM_ROW_ALIGNMENT.
+static uint64_t binproblem_align(uint64_t offset){
+    return ((offset+PROBLEM_ROW_ALIGNMENT-1)/PROBLEM_ROW_ALIGNMENT)*PROBLEM_ROW_ALIGNMENT;
+}
+
+#define BINPROBLEM_CHECKSUM_LANES 4
+
+// Adds size bytes (a multiple of 8*BINPROBLEM_CHECKSUM_LANES) to the checksum lanes, each 64-bit word goes to its own lane
+// so that they are independent and the checksum runs at memory speed.
+static void binproblem_checksum_update(uint64_t *lanes, const char *data, size_t size){
+    assert(size%(8*BINPROBLEM_CHECKSUM_LANES)==0);
+    for(size_t i=0;i<size;i+=8*BINPROBLEM_CHECKSUM_LANES){
+        for(int l=0;l<BINPROBLEM_CHECKSUM_LANES;l++){
+            uint64_t word;
+            memcpy(&word,&data[i+8*l],8);
+            lanes[l] = (lanes[l]^word)*0x100000001b3ULL;
+            lanes[l] ^= lanes[l]>>29;
+        }
+    }
+}
+
+// Checksum of the part of the binary format after the header, from its contiguous regions.
+static uint64_t binproblem_checksum(const char **regions, const size_t *sizes, int n_regions){
+    uint64_t lanes[BINPROBLEM_CHECKSUM_LANES];
+    for(int l=0;l<BINPROBLEM_CHECKSUM_LANES;l++) lanes[l] = 0xcbf29ce484222325ULL+l;
+    for(int r=0;r<n_regions;r++) binproblem_checksum_update(lanes,regions[r],sizes[r]);
+    uint64_t checksum = 0;
+    for(int l=0;l<BINPROBLEM_CHECKSUM_LANES;l++) checksum = hash_fac(l)^((checksum^lanes[l])*0x9e3779b97f4a7c15ULL);
+    return checksum;
+}
+
+problem *load_binary_format(const char *file){
+    int fd = open(file,O_RDONLY);
+    if(fd<0){
+        fprintf(stderr,"ERROR: couldn't open file \"%s\"!\n",file);
+        exit(1);
+    }
+    struct stat file_stat;
+    binproblem_header head;
+    if(fstat(fd,&file_stat)!=0 || pread(fd,&head,sizeof(head),0)!=sizeof(head)){
+        fprintf(stderr,"ERROR: couldn't read the binary header!\n");
+        exit(1);
+    }
+
+    // Check that the header is consistent with the file
+    int valid = head.n_facs>0 && head.n_clis>0 && (head.cost_size==sizeof(float) || head.cost_size==sizeof(double));
+    valid = valid && head.cli_stride>=head.n_clis && head.file_size==(uint64_t)file_stat.st_size;
+    valid = valid && head.facility_cost_offset>=sizeof(head) && head.facility_cost_offset%PROBLEM_ROW_ALIGNMENT==0;
+    valid = valid && head.distance_cost_offset>=head.facility_cost_offset+sizeof(double)*head.n_facs;
+    valid = valid && head.distance_cost_offset%PROBLEM_ROW_ALIGNMENT==0;
+    valid = valid && head.file_size==head.distance_cost_offset+(uint64_t)head.cost_size*head.cli_stride*(head.n_facs+1);
+    if(!valid){
+        fprintf(stderr,"ERROR: invalid binary header!\n");
+        exit(1);
+    }
+    size_t body_size = head.file_size-head.facility_cost_offset;
+
+    problem *prob;
+    const char *body;
+    if(head.cost_size==sizeof(costval) && head.cli_stride==problem_row_stride(head.n_clis)){
+        // Same layout, map it as it is
+        prob = problem_init_mapped(head.n_facs,head.n_clis,fd,head.file_size,head.facility_cost_offset,head.distance_cost_offset);
+        prob->lossless_costs = head.lossless_costs;
+        body = (const char *)prob->mapping+head.facility_cost_offset;
+        if(binproblem_checksum(&body,&body_size,1)!=head.checksum){
+            fprintf(stderr,"ERROR: wrong checksum on the binary file!\n");
+            exit(1);
+        }
+    }else{
+        // Written with the other cost type, convert it
+        printf("Converting costs from %d to %d bytes.\n",head.cost_size,(int)sizeof(costval));
+        void *mapping = mmap(NULL,head.file_size,PROT_READ,MAP_PRIVATE,fd,0);
+        if(mapping==MAP_FAILED){
+            fprintf(stderr,"ERROR: couldn't map the problem file (%lu B): %s\n",(size_t)head.file_size,strerror(errno));
+            exit(1);
+        }
+        body = (const char *)mapping+head.facility_cost_offset;
+        if(binproblem_checksum(&body,&body_size,1)!=head.checksum){
+            fprintf(stderr,"ERROR: wrong checksum on the binary file!\n");
+            exit(1);
+        }
+        prob = problem_init(head.n_facs,head.n_clis);
+        memcpy(prob->facility_cost,(const char *)mapping+head.facility_cost_offset,sizeof(double)*prob->n_facs);
+        for(int i=0;i<prob->n_facs;i++){
+            const char *row = (const char *)mapping+head.distance_cost_offset+(size_t)head.cost_size*head.cli_stride*(i+1);
+            for(int j=0;j<prob->n_clis;j++){
+                double dist = head.cost_size==sizeof(float)? ((const float *)row)[j] : ((const double *)row)[j];
+                problem_set_assig_cost(prob,i,j,dist);
+            }
+        }
+        if(!head.lossless_costs) prob->lossless_costs = 0;
+        munmap(mapping,head.file_size);
+        close(fd);
+    }
+    prob->size_restriction_minimum = head.size_restriction_minimum;
+    prob->size_restriction_maximum = head.size_restriction_maximum;
+    return prob;
+}
+
+void problem_save_binary(const problem *prob, const char *file){
+    binproblem_header head;
+    memset(&head,0,sizeof(head));
+    memcpy(head.magic,BINPROBLEM_MAGIC,BINPROBLEM_MAGIC_SIZE);
+    head.cost_size = sizeof(costval);
+    head.n_facs = prob->n_facs;
+    head.n_clis = prob->n_clis;
+    head.cli_stride = prob->cli_stride;
+    head.size_restriction_minimum = prob->size_restriction_minimum;
+    head.size_restriction_maximum = prob->size_restriction_maximum;
+    head.lossless_costs = prob->lossless_costs;
+    head.facility_cost_offset = binproblem_align(sizeof(head));
+    head.distance_cost_offset = binproblem_align(head.facility_cost_offset+sizeof(double)*prob->n_facs);
+    size_t slab_size = sizeof(costval)*(size_t)prob->cli_stride*(prob->n_facs+1);
+    head.file_size = head.distance_cost_offset+slab_size;
+    // The facility costs, padded up to the cost matrix, and the cost matrix from row -1
+    size_t facs_size = head.distance_cost_offset-head.facility_cost_offset;
+    char *facs_region = safe_malloc(facs_size);
+    memset(facs_region,0,facs_size);
+    memcpy(facs_region,prob->facility_cost,sizeof(double)*prob->n_facs);
+    const char *regions[2] = {facs_region,(const char *)problem_assig_row(prob,-1)};
+    size_t sizes[2] = {facs_size,slab_size};
+    head.checksum = binproblem_checksum(regions,sizes,2);
+    // Write the header, padded up to the facility costs, and the regions
+    char header_region[head.facility_cost_offset];
+    memset(header_region,0,sizeof(header_region));
+    memcpy(header_region,&head,sizeof(head));
+    FILE *fp = fopen(file,"wb");
+    if(fp==NULL){
+        fprintf(stderr,"ERROR: couldn't open file \"%s\"!\n",file);
+        exit(1);
+    }
+    int ok = fwrite(header_region,1,sizeof(header_region),fp)==sizeof(header_region);
+    for(int r=0;r<2;r++) ok = ok && fwrite(regions[r],1,sizes[r],fp)==sizes[r];
+    if(fclose(fp)!=0) ok = 0;
+    if(!ok){
+        fprintf(stderr,"ERROR: couldn't write the binary file \"%s\"!\n",file);
+        exit(1);
+    }
+    free(facs_region);
+}
+
+// Text of an input file, read at once and split on tokens separated by whitespace.
+typedef struct {
+    // | Text, followed by a '\0'.
+    const char *text;
+    // | Position of the next character to read and end of the text (or of the part of it that is read).
+    size_t pos, end;
+} loadtext;
+
+// Reads the rest of a file on a loadtext, the text must be freed.
+static loadtext loadtext_read(FILE *fp){
+    long start = ftell(fp);
+    if(start<0 || fseek(fp,0,SEEK_END)!=0){
+        fprintf(stderr,"ERROR: couldn't get the size of the file!\n");
+        exit(1);
+    }
+    size_t size = ftell(fp)-start;
+    fseek(fp,start,SEEK_SET);
+    char *text = safe_malloc(size+1);
+    if(fread(text,1,size,fp)!=size){
+        fprintf(stderr,"ERROR: couldn't read the file!\n");
+        exit(1);
+    }
+    text[size] = '\0';
+    loadtext lt = {text,0,size};
+    return lt;
+}
+
+static inline int load_is_space(char c){
+    return c==' ' || c=='\n' || c=='\r' || c=='\t' || c=='\v' || c=='\f';
+}
+
+// Returns the next token and sets *len to its length, NULL at the end of the text.
+static inline const char *loadtext_token(loadtext *lt, size_t *len){
+    while(lt->pos<lt->end && load_is_space(lt->text[lt->pos])) lt->pos++;
+    if(lt->pos>=lt->end) return NULL;
+    const char *tok = &lt->text[lt->pos];
+    while(lt->pos<lt->end && !load_is_space(lt->text[lt->pos])) lt->pos++;
+    *len = &lt->text[lt->pos]-tok;
+    return tok;
+}
+
+// Exact powers of 10 on double.
+static const double load_pow10[] = {
+    1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,1e11,
+    1e12,1e13,1e14,1e15,1e16,1e17,1e18,1e19,1e20,1e21,1e22};
+
+// Parses a decimal number that is the whole token, returns 1 on success.
+// When its digits fit on 53 bits and its exponent is at most 22, the number is computed with a single rounded
+// multiplication or division of exact values, which gives the same result as strtod, otherwise strtod is used.
+static inline int load_parse_double(const char *tok, size_t len, double *out){
+    const char *p = tok, *end = tok+len;
+    int negative = 0;
+    if(p<end && (*p=='-' || *p=='+')){
+        negative = *p=='-';
+        p++;
+    }
+    uint64_t mantissa = 0;
+    int exponent = 0, n_digits = 0;
+    for(;p<end && '0'<=*p && *p<='9';p++,n_digits++){
+        mantissa = mantissa*10+(*p-'0');
+        if(mantissa>=(1ULL<<53)) goto slow;
+    }
+    if(p<end && *p=='.'){
+        for(p++;p<end && '0'<=*p && *p<='9';p++,n_digits++){
+            mantissa = mantissa*10+(*p-'0');
+            exponent -= 1;
+            if(mantissa>=(1ULL<<53)) goto slow;
+        }
+    }
+    if(n_digits==0) goto slow;
+    if(p<end && (*p=='e' || *p=='E')){
+        p++;
+        int exp_negative = 0;
+        if(p<end && (*p=='-' || *p=='+')){
+            exp_negative = *p=='-';
+            p++;
+        }
+        if(p==end) goto slow;
+        int exp_value = 0;
+        for(;p<end && '0'<=*p && *p<='9';p++){
+            exp_value = exp_value*10+(*p-'0');
+            if(exp_value>1000) goto slow;
+        }
+        exponent += exp_negative? -exp_value : exp_value;
+    }
+    if(p!=end || exponent<-22 || exponent>22) goto slow;
+    double value = (double) mantissa;
+    value = exponent<0? value/load_pow10[-exponent] : value*load_pow10[exponent];
+    *out = negative? -value : value;
+    return 1;
+    slow:;
+    // The token is followed by whitespace or the end of the text, so strtod doesn't read past it
+    char *num_end;
+    *out = strtod(tok,&num_end);
+    return len>0 && num_end==end;
+}
+
+// Parses an integer that is the whole token, returns 1 on success.
+static inline int load_parse_int(const char *tok, size_t len, int *out){
+    const char *p = tok, *end = tok+len;
+    int negative = 0;
+    if(p<end && (*p=='-' || *p=='+')){
+        negative = *p=='-';
+        p++;
+    }
+    if(p==end) return 0;
+    long long int value = 0;
+    for(;p<end;p++){
+        if(*p<'0' || '9'<*p) return 0;
+        value = value*10+(*p-'0');
+        if(value>INT_MAX) return 0;
+    }
+    *out = negative? -value : value;
+    return 1;
+}
+
+// Reads the next token as a double, returns 1 on success.
+static inline int loadtext_double(loadtext *lt, double *out){
+    size_t len;
+    const char *tok = loadtext_token(lt,&len);
+    return tok!=NULL && load_parse_double(tok,len,out);
+}
+
+// Reads the next token as an int, returns 1 on success.
+static inline int loadtext_int(loadtext *lt, int *out){
+    size_t len;
+    const char *tok = loadtext_token(lt,&len);
+    return tok!=NULL && load_parse_int(tok,len,out);
+}
+
+// Reads the row of facility i of the Simple format, returns 0 if a cost lost precision.
+static int load_simple_row(loadtext *lt, problem *prob, int i){
+    // Read facility index
+    int facility_index;
+    if(!loadtext_int(lt,&facility_index) || facility_index!=i+1){
+        fprintf(stderr,"ERROR: index of facility %d expected!\n",i+1);
+        exit(1);
+    }
+
+    // Read facility cost
+    if(!loadtext_double(lt,&prob->facility_cost[i])){
+        fprintf(stderr,"ERROR: facility %d cost expected!\n",i);
+        exit(1);
+    }
+
+    // Read each distance
+    int lossless = 1;
+    costval *row = problem_assig_row(prob,i);
+    for(int j=0;j<prob->n_clis;j++){
+        double dist;
+        if(!loadtext_double(lt,&dist)){
+            fprintf(stderr,"ERROR: distance from facility %d to client %d expected!\n",i,j);
+            exit(1);
+        }
+        lossless &= problem_store_cost(&row[j],dist);
+        problem_set_exact_cost(prob,i,j,dist);
+    }
+    return lossless;
+}
+
+typedef struct {
+    const loadtext *lt;
+    problem *prob;
+    // | Start of the line of each facility.
+    const size_t *line_starts;
+    // | Counter to claim facilities.
+    int *next_facility;
+    // | Set to 0 if a cost of the facilities read by this thread lost precision.
+    int lossless;
+} load_simple_rows_args;
+
+void *load_simple_rows_thread_execution(void *arg){
+    load_simple_rows_args *args = (load_simple_rows_args *) arg;
+    args->lossless = 1;
+    int i;
+    while((i=threadpool_claim(args->next_facility))<args->prob->n_facs){
+        // Read the line of the facility
+        loadtext line = *args->lt;
+        line.pos = args->line_starts[i];
+        line.end = args->line_starts[i+1];
+        args->lossless &= load_simple_row(&line,args->prob,i);
+        size_t len;
+        assert(loadtext_token(&line,&len)==NULL);
+    }
+    return NULL;
+}
+
+// Finds the start of the line of each facility of the Simple format, after the header, with line_starts[n_facs] at the end.
+// Returns 1 only if each non-empty line i holds exactly the row of facility i+1 (its index, cost and n_clis distances),
+// so that the lines can be read in parallel with the same result as reading the tokens sequentially.
+static int load_simple_lines(const loadtext *lt, int n_facs, int n_clis, size_t *line_starts){
+    int n_lines = 0;
+    size_t pos = lt->pos;
+    while(pos<lt->end){
+        const char *newline = memchr(&lt->text[pos],'\n',lt->end-pos);
+        size_t line_end = newline!=NULL? (size_t)(newline-lt->text) : lt->end;
+        // Count the tokens of the line, checking the first one
+        loadtext line = *lt;
+        line.pos = pos;
+        line.end = line_end;
+        size_t len;
+        const char *tok = loadtext_token(&line,&len);
+        if(tok!=NULL){
+            int facility_index;
+            if(n_lines==n_facs || !load_parse_int(tok,len,&facility_index) || facility_index!=n_lines+1) return 0;
+            long long int n_tokens = 1;
+            for(size_t k=line.pos;k<line_end;k++){
+                n_tokens += load_is_space(lt->text[k-1]) && !load_is_space(lt->text[k]);
+            }
+            if(n_tokens!=(long long int)n_clis+2) return 0;
+            line_starts[n_lines] = pos;
+            n_lines += 1;
+        }
+        pos = line_end+1;
+    }
+    line_starts[n_lines] = lt->end;
+    return n_lines==n_facs;
+}
+
+problem *load_simple_format(loadtext *lt, int n_threads){
     // Read filename in header:
-    char buffer[400];
-    if(fscanf(fp,"FILE: %s",buffer)!=1){
+    size_t len;
+    const char *tok = loadtext_token(lt,&len);
+    if(tok==NULL || len!=5 || strncmp(tok,"FILE:",5)!=0 || loadtext_token(lt,&len)==NULL){
         fprintf(stderr,"ERROR: couldn't read FILE!\n");
         exit(1);
     }
 
     // Read the number of facilities:
     int n_facs;
-    if(fscanf(fp,"%d",&n_facs)!=1){
+    if(!loadtext_int(lt,&n_facs)){
         fprintf(stderr,"ERROR: number of facilities expected!\n");
         exit(1);
     }
 
     // Read the number of clients:
     int n_clis;
-    if(fscanf(fp,"%d",&n_clis)!=1){
+    if(!loadtext_int(lt,&n_clis)){
         fprintf(stderr,"ERROR: number of clients expected!\n");
         exit(1);
     }
@@ -27,7 +394,7 @@ problem *load_simple_format(FILE *fp){
 
     // Third argument is the size restriction.
     int trd_num;
-    if(fscanf(fp,"%d",&trd_num)!=1){
+    if(!loadtext_int(lt,&trd_num)){
         fprintf(stderr,"ERROR: size restriction expected!\n");
         exit(1);
     }
@@ -35,46 +402,62 @@ problem *load_simple_format(FILE *fp){
     prob->size_restriction_maximum = trd_num;
     prob->size_restriction_minimum = trd_num;
 
-    // For each facility
-    for(int i=0;i<prob->n_facs;i++){
-
-        // Read facility index
-        int facility_index;
-        if(fscanf(fp,"%d",&facility_index)!=1){
-            fprintf(stderr,"ERROR: facility index expected!\n");
+    // Rows are independent, so when each facility is on its own line they can be read in parallel
+    size_t *line_starts = NULL;
+    if(n_threads>1){
+        line_starts = safe_malloc(sizeof(size_t)*(prob->n_facs+1));
+        if(!load_simple_lines(lt,prob->n_facs,prob->n_clis,line_starts)){
+            free(line_starts);
+            line_starts = NULL;
         }
-        assert(i+1==facility_index);
+    }
 
-        // Read facility cost
-        if(fscanf(fp,"%lf",&prob->facility_cost[i])!=1){
-            fprintf(stderr,"ERROR: facility %d cost expected!\n",i);
-            exit(1);
+    if(line_starts!=NULL){
+        threadpool *pool = threadpool_init(n_threads);
+        load_simple_rows_args *targs = safe_malloc(sizeof(load_simple_rows_args)*n_threads);
+        int next_facility = 0;
+        for(int t=0;t<n_threads;t++){
+            targs[t].lt = lt;
+            targs[t].prob = prob;
+            targs[t].line_starts = line_starts;
+            targs[t].next_facility = &next_facility;
         }
-
-        // Read each distance
-        for(int j=0;j<prob->n_clis;j++){
-            if(fscanf(fp,"%lf",&prob->distance_cost[i][j])!=1){
-                fprintf(stderr,"ERROR: distance from facility %d to client %d expected!\n",i,j);
-                exit(1);
-            }
+        threadpool_execute(pool,load_simple_rows_thread_execution,targs,sizeof(load_simple_rows_args));
+        for(int t=0;t<n_threads;t++){
+            if(!targs[t].lossless) prob->lossless_costs = 0;
         }
+        free(targs);
+        threadpool_free(pool);
+        free(line_starts);
+        lt->pos = lt->end;
+    }else{
+        // For each facility
+        for(int i=0;i<prob->n_facs;i++){
+            if(!load_simple_row(lt,prob,i)) prob->lossless_costs = 0;
+        }
+    }
+
+    // Both ways must have read every token
+    if(loadtext_token(lt,&len)!=NULL){
+        fprintf(stderr,"ERROR: more values than the rows of %d facilities!\n",prob->n_facs);
+        exit(1);
     }
 
     return prob;
 }
 
-problem *load_orlib_format(FILE *fp){
+problem *load_orlib_format(loadtext *lt){
 
     // Read the number of facilities:
     int n_facs;
-    if(fscanf(fp,"%d",&n_facs)!=1){
+    if(!loadtext_int(lt,&n_facs)){
         fprintf(stderr,"ERROR: number of facilities expected!\n");
         exit(1);
     }
 
     // Read the number of clients:
     int n_clis;
-    if(fscanf(fp,"%d",&n_clis)!=1){
+    if(!loadtext_int(lt,&n_clis)){
         fprintf(stderr,"ERROR: number of clients expected!\n");
         exit(1);
     }
@@ -87,13 +470,14 @@ problem *load_orlib_format(FILE *fp){
 
         // Read facility capacity
         double capacity = 0;
-        char cap_text[200];
-        if(fscanf(fp,"%s",cap_text)!=1){
+        size_t len;
+        const char *cap_text = loadtext_token(lt,&len);
+        if(cap_text==NULL){
             fprintf(stderr,"ERROR: facility capacity expected!\n");
             exit(1);
         }
-        if(strcmp(cap_text,"capacity")!=0){
-            if(sscanf(cap_text,"%lf",&capacity)!=1){
+        if(len!=8 || strncmp(cap_text,"capacity",8)!=0){
+            if(!load_parse_double(cap_text,len,&capacity)){
                 fprintf(stderr,"ERROR: facility capacity isn't valid!\n");
                 exit(1);
             }
@@ -104,7 +488,7 @@ problem *load_orlib_format(FILE *fp){
         }
 
         // Read facility cost
-        if(fscanf(fp,"%lf",&prob->facility_cost[i])!=1){
+        if(!loadtext_double(lt,&prob->facility_cost[i])){
             fprintf(stderr,"ERROR: facility %d cost expected!\n",i);
             exit(1);
         }
@@ -115,7 +499,7 @@ problem *load_orlib_format(FILE *fp){
     for(int j=0;j<prob->n_clis;j++){
         // Read client demand
         double demand;
-        if(fscanf(fp,"%lf",&demand)!=1){
+        if(!loadtext_double(lt,&demand)){
             fprintf(stderr,"ERROR: client %d demand expected!\n",j);
         }
         if(demand!=0) all_demands_0 = 0;
@@ -123,12 +507,12 @@ problem *load_orlib_format(FILE *fp){
         // Add distances to facility-city matrix:
         for(int i=0;i<prob->n_facs;i++){
             double dist;
-            if(fscanf(fp,"%lf",&dist)!=1){
+            if(!loadtext_double(lt,&dist)){
                 fprintf(stderr,"ERROR: cost from facility %d to client %d expected!\n",i,j);
                 exit(1);
             }
             assert(demand!=0 || all_demands_0 || dist==0);
-            prob->distance_cost[i][j] = dist;
+            problem_set_assig_cost(prob,i,j,dist);
         }
     }
 
@@ -139,37 +523,61 @@ problem *load_orlib_format(FILE *fp){
     return prob;
 }
 
-problem *new_problem_load(const char *file){
+problem *new_problem_load(const char *file, int n_threads, int allow_lossy){
     printf("Reading file \"%s\"...\n",file);
     FILE *fp = fopen(file,"r");
     if(fp==NULL){
         fprintf(stderr,"ERROR: couldn't open file \"%s\"!\n",file);
         exit(1);
     }
-    // Read first string to check if it is on SIMPLE format
-    char buffer[400];
-    if(fscanf(fp,"%s",buffer)!=1){
-        fprintf(stderr,"ERROR: couldn't read first string!\n");
-        exit(1);
-    }
-
+    // Read the first bytes to check if it is on the binary format
+    char magic[BINPROBLEM_MAGIC_SIZE];
+    int binary = fread(magic,1,BINPROBLEM_MAGIC_SIZE,fp)==BINPROBLEM_MAGIC_SIZE &&
+        memcmp(magic,BINPROBLEM_MAGIC,BINPROBLEM_MAGIC_SIZE)==0;
     fseek(fp,0,SEEK_SET); // Reset reading
     problem *prob;
 
-    // Check if it is simple format
-    if(strcmp(buffer,"FILE:")==0){
-        printf("SIMPLE format identified.\n");
-        prob = load_simple_format(fp);
+    if(binary){
+        printf("BINARY format identified.\n");
+        prob = load_binary_format(file);
     }else{
-        buffer[2] = '\0';
-        // Assume ORLIB format
-        printf("ORLIB format assumed.\n");
-        prob = load_orlib_format(fp);
+        loadtext lt = loadtext_read(fp);
+
+        // Read first string to check if it is on SIMPLE format
+        size_t len;
+        const char *first = loadtext_token(&lt,&len);
+        if(first==NULL){
+            fprintf(stderr,"ERROR: couldn't read first string!\n");
+            exit(1);
+        }
+
+        lt.pos = 0; // Reset reading
+
+        // Check if it is simple format
+        if(len==5 && strncmp(first,"FILE:",5)==0){
+            printf("SIMPLE format identified.\n");
+            prob = load_simple_format(&lt,n_threads);
+        }else{
+            // Assume ORLIB format
+            printf("ORLIB format assumed.\n");
+            prob = load_orlib_format(&lt);
+        }
+        free((char *)lt.text);
     }
 
     // Close file
     fclose(fp);
     printf("Done reading.\n");
 
+    // Fail if the costs don't fit on the storage type (e.g. non integral or larger than 2^24 on float), unless allowed
+    if(!prob->lossless_costs){
+        if(!allow_lossy){
+            fprintf(stderr,"ERROR: some costs lose precision when stored as %s, use a build without -D COST_FLOAT or -F to accept it.\n",
+                COSTVAL_NAME);
+            exit(1);
+        }
+        fprintf(stderr,"WARNING: some costs lost precision when stored as %s.\n",COSTVAL_NAME);
+    }
+
     return prob;
 }
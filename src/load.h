@@ -4,7 +4,39 @@
 #include "utils.h"
 #include "problem.h"
 
+/*
+Binary problem format, written by `dc -C` so that the problem can be mapped into memory without parsing it.
+It is the header, followed by the facility costs (double) and the cost matrix with the layout of the problem
+(the row of facility -1 and then the row of each facility, cli_stride costval each), each one starting on an offset multiple
+of PROBLEM_ROW_ALIGNMENT. Values are stored with the byte order of the machine that wrote it.
+*/
+
+#define BINPROBLEM_MAGIC "DCPROB\x01\n"
+#define BINPROBLEM_MAGIC_SIZE 8
+
+typedef struct {
+    // | BINPROBLEM_MAGIC, including the format version.
+    char magic[BINPROBLEM_MAGIC_SIZE];
+    // | Size of each stored cost, sizeof(costval) of the build that wrote it.
+    int32_t cost_size;
+    int32_t n_facs, n_clis;
+    // | Number of costval between consecutive rows of the cost matrix.
+    int32_t cli_stride;
+    int32_t size_restriction_minimum, size_restriction_maximum;
+    int32_t lossless_costs;
+    int32_t reserved;
+    // | Offsets of the facility costs and the cost matrix (row -1) and the total size of the file.
+    uint64_t facility_cost_offset, distance_cost_offset, file_size;
+    // | Checksum of everything after the header.
+    uint64_t checksum;
+} binproblem_header;
+
 // Loads a problem from a given file and performs precomputations.
-problem *new_problem_load(const char *file);
+// Problems on the Simple format are parsed with n_threads threads.
+// Unless allow_lossy is set, it fails if some cost loses precision when stored as costval.
+problem *new_problem_load(const char *file, int n_threads, int allow_lossy);
+
+// Saves a problem on the binary format.
+void problem_save_binary(const problem *prob, const char *file);
 
 #endif
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "localsearch.h"
 
+#include <sys/time.h>
+
 void update_phi1_and_phi2(const problem *prob, const solution *sol, int f_ins, int f_rem,
         int *phi1, int *phi2, int *affected_mask){
     for(int i=0;i<prob->n_clis;i++){
@@ -71,6 +73,20 @@ void solutions_sort_and_delete_repeated(solution **sols, int *n_sols){
 }
 
 
+// Wall seconds since the given time.
+static double seconds_since(struct timeval start){
+    struct timeval now;
+    gettimeofday(&now,NULL);
+    return (now.tv_sec-start.tv_sec) + 1e-6*(now.tv_usec-start.tv_usec);
+}
+
+// Adds the time that a thread spent working on a job to the runinfo, the rest of the job is idle time.
+static void add_thread_time(rundata *run, int thread_id, double busy_seconds, double job_seconds){
+    run->run_inf->thread_busy_seconds[thread_id] += busy_seconds;
+    run->run_inf->thread_idle_seconds[thread_id] += job_seconds-busy_seconds;
+}
+
+
 // ============================================================================
 // ======== LOCAL SEARCH
 // ============================================================================
@@ -80,27 +96,37 @@ typedef struct {
     const rundata *run;
     solution **sols;
     int n_sols;
+    int *next_sol;
+    uint64_t seed;
     int n_moves;
     shuffler *shuff;
+    double busy_seconds;
 } hillclimb_thread_args;
 
 void *hillclimb_thread_execution(void *arg){
     hillclimb_thread_args *args = (hillclimb_thread_args *) arg;
+    struct timeval start;
+    gettimeofday(&start,NULL);
+    // The solutions are claimed one by one, as the number of moves of each local search varies a lot
+    int r = threadpool_claim(args->next_sol);
     if(args->run->local_search==SWAP_RESENDE_WERNECK){
-        if(args->thread_id<args->n_sols){
+        if(r<args->n_sols){
             fastmat *mat = fastmat_init(args->run->prob->n_facs,args->run->prob->n_facs);
-            for(int r=args->thread_id;r<args->n_sols;r+=args->run->n_threads){
+            for(;r<args->n_sols;r=threadpool_claim(args->next_sol)){
                 // Perform local search on the given solution
                 args->n_moves += solution_resendewerneck_hill_climbing(args->run,&args->sols[r],NULL,mat);
             }
             fastmat_free(mat);
         }
     }else{
-        for(int r=args->thread_id;r<args->n_sols;r+=args->run->n_threads){
+        for(;r<args->n_sols;r=threadpool_claim(args->next_sol)){
+            // Each solution has its own random order, independent of the thread that performs its local search
+            if(args->shuff) shuffler_reseed(args->shuff,args->seed^hash_fac(r));
             // Perform local search on the given solution
             args->n_moves += solution_whitaker_hill_climbing(args->run,&args->sols[r],NULL,args->shuff);
         }
     }
+    args->busy_seconds = seconds_since(start);
     return NULL;
 }
 
@@ -108,42 +134,44 @@ void *hillclimb_thread_execution(void *arg){
 void solutions_hill_climbing(rundata *run, solution **sols, int n_sols){
     // Start measuring time
     clock_t start = clock();
-    // Allocate memory for threads and arguments
-    pthread_t *threads = safe_malloc(sizeof(pthread_t)*run->n_threads);
+    // Random seed for the random orders of the local searches
+    uint64_t seed = 0;
+    if(run->local_search==SWAP_FIRST_IMPROVEMENT) seed = ((uint64_t)rand()<<32)^(uint64_t)rand();
+    // Allocate memory for arguments
+    int next_sol = 0;
     hillclimb_thread_args *targs = safe_malloc(sizeof(hillclimb_thread_args)*run->n_threads);
-    // Call all threads to perform local search
     for(int i=0;i<run->n_threads;i++){
         // Set arguments for the thread
         targs[i].thread_id = i;
         targs[i].run = run;
         targs[i].sols = sols;
         targs[i].n_sols = n_sols;
+        targs[i].next_sol = &next_sol;
+        targs[i].seed = seed;
         targs[i].n_moves = 0;
+        targs[i].busy_seconds = 0;
         // Set random number generator for the thread
         if(run->local_search==SWAP_FIRST_IMPROVEMENT){
             targs[i].shuff = shuffler_init(run->prob->n_facs);
         }else{
             targs[i].shuff = NULL;
         }
-        // Create thread
-        int rc = pthread_create(&threads[i],NULL,hillclimb_thread_execution,&targs[i]);
-        if(rc){
-            fprintf(stderr,"ERROR: Error %d on pthread_create\n",rc);
-            exit(1);
-        }
     }
-    // Join threads
+    // Call all threads to perform local search
+    struct timeval job_start;
+    gettimeofday(&job_start,NULL);
+    threadpool_execute(run->pool,hillclimb_thread_execution,targs,sizeof(hillclimb_thread_args));
+    double job_seconds = seconds_since(job_start);
     int n_moves = 0;
-    for(int i=0;i<run->n_threads;i++){ // Join threads
-        pthread_join(threads[i],NULL);
+    for(int i=0;i<run->n_threads;i++){
         n_moves += targs[i].n_moves;
+        add_thread_time(run,i,targs[i].busy_seconds,job_seconds);
     }
     // Free memory
     for(int i=0;i<run->n_threads;i++){
         if(targs[i].shuff!=NULL) shuffler_free(targs[i].shuff);
     }
     free(targs);
-    free(threads);
     // End measuring time
     clock_t end = clock();
     double seconds = (double)(end - start) / (double)CLOCKS_PER_SEC;
@@ -162,12 +190,17 @@ typedef struct {
     const rundata *run;
     solution **pool;
     int n_pool;
+    int *next_pair;
+    uint64_t seed;
     solution **result;
     shuffler *shuff;
+    double busy_seconds;
 } path_relinking_thread_args;
 
 void *path_relinking_thread_execution(void *arg){
     path_relinking_thread_args *args = (path_relinking_thread_args *) arg;
+    struct timeval start;
+    gettimeofday(&start,NULL);
 
     // Allocate a unique reusable fastmat if SWAP_RESENDE_WERNECK
     fastmat *mat = NULL;
@@ -175,58 +208,73 @@ void *path_relinking_thread_execution(void *arg){
         mat = fastmat_init(args->run->prob->n_facs,args->run->prob->n_facs);
     }
 
-    int c_pair = 0;
-    for(int i=0;i<args->n_pool;i++){
-        for(int j=i+1;j<args->n_pool;j++){
-            // Check if this pair should be linked by the current thread
-            if(c_pair%args->run->n_threads==args->thread_id){
-
-                // Pick initial and ending solution from the pair according to solution value
-                const solution *sol_ini, *sol_end;
-                if(args->pool[i]->value >= args->pool[j]->value){
-                    sol_ini = args->pool[i];
-                    sol_end = args->pool[j];
-                }else{
-                    sol_ini = args->pool[j];
-                    sol_end = args->pool[i];
-                }
+    // The pairs are claimed one by one, in increasing order for each thread.
+    // Pair c_pair is (i,j), with pairs (i,i+1) to (i,n_pool-1) starting at row_start.
+    int n_pairs = args->n_pool*(args->n_pool-1)/2;
+    int i = 0;
+    int row_start = 0;
+    for(int c_pair=threadpool_claim(args->next_pair);c_pair<n_pairs;c_pair=threadpool_claim(args->next_pair)){
+        while(c_pair>=row_start+(args->n_pool-1-i)){
+            row_start += args->n_pool-1-i;
+            i += 1;
+        }
+        int j = i+1+(c_pair-row_start);
 
-                // Perform path relinking
-                solution *sol = solution_copy(args->run->prob,sol_ini);
-                if(args->run->local_search_pr==SWAP_RESENDE_WERNECK){
-                    solution_resendewerneck_hill_climbing(args->run,&sol,sol_end,mat);
-                }else{
-                    solution_whitaker_hill_climbing(args->run,&sol,sol_end,args->shuff);
-                }
+        // Pick initial and ending solution from the pair according to solution value
+        const solution *sol_ini, *sol_end;
+        if(args->pool[i]->value >= args->pool[j]->value){
+            sol_ini = args->pool[i];
+            sol_end = args->pool[j];
+        }else{
+            sol_ini = args->pool[j];
+            sol_end = args->pool[i];
+        }
+
+        // Perform path relinking
+        solution *sol = solution_copy(args->run->prob,sol_ini);
+        if(args->run->local_search_pr==SWAP_RESENDE_WERNECK){
+            solution_resendewerneck_hill_climbing(args->run,&sol,sol_end,mat);
+        }else{
+            if(args->shuff) shuffler_reseed(args->shuff,args->seed^hash_fac(c_pair));
+            solution_whitaker_hill_climbing(args->run,&sol,sol_end,args->shuff);
+        }
 
-                args->result[c_pair] = sol;
+        args->result[c_pair] = sol;
 
-                // Chack that path relinking was performed correctly
-                #ifdef DEBUG
-                    // Check that all facilitites in sol came from one of the solutions
-                    for(int k=0; k<sol->n_facs; k++){
-                        int in_ini = elem_in_sorted(sol_ini->facs,sol_ini->n_facs,sol->facs[k]);
-                        int in_end = elem_in_sorted(sol_end->facs,sol_end->n_facs,sol->facs[k]);
-                        assert(in_ini || in_end);
-                    }
-                    // Check that all facilities in both solutions remain in sol
-                    for(int k=0; k<sol_ini->n_facs; k++){
-                        int f = sol_ini->facs[k];
-                        if(elem_in_sorted(sol_end->facs, sol_end->n_facs, f)){
-                            assert(elem_in_sorted(sol->facs,sol->n_facs,f));
-                        }
+        // Chack that path relinking was performed correctly
+        #ifdef DEBUG
+            assert(i<j && j<args->n_pool);
+            if(sol->facs_bits!=NULL && sol_ini->facs_bits!=NULL && sol_end->facs_bits!=NULL){
+                // Same checks with a bit test for each facility
+                for(int k=0; k<sol->n_facs; k++){
+                    int f = sol->facs[k];
+                    assert(bitset_test(sol_ini->facs_bits,f) || bitset_test(sol_end->facs_bits,f));
+                }
+                for(int k=0; k<sol_ini->n_facs; k++){
+                    int f = sol_ini->facs[k];
+                    if(bitset_test(sol_end->facs_bits,f)) assert(bitset_test(sol->facs_bits,f));
+                }
+            }else{
+                // Check that all facilitites in sol came from one of the solutions
+                for(int k=0; k<sol->n_facs; k++){
+                    int in_ini = elem_in_sorted(sol_ini->facs,sol_ini->n_facs,sol->facs[k]);
+                    int in_end = elem_in_sorted(sol_end->facs,sol_end->n_facs,sol->facs[k]);
+                    assert(in_ini || in_end);
+                }
+                // Check that all facilities in both solutions remain in sol
+                for(int k=0; k<sol_ini->n_facs; k++){
+                    int f = sol_ini->facs[k];
+                    if(elem_in_sorted(sol_end->facs, sol_end->n_facs, f)){
+                        assert(elem_in_sorted(sol->facs,sol->n_facs,f));
                     }
-                #endif
+                }
             }
-            c_pair += 1;
-        }
+        #endif
     }
 
-    assert(c_pair== args->n_pool*(args->n_pool-1)/2);
-
     if(mat) fastmat_free(mat);
 
-
+    args->busy_seconds = seconds_since(start);
     return NULL;
 }
 
@@ -237,44 +285,43 @@ void solutions_path_relinking(rundata *run, solution ***sols, int *n_sols){
     // Allocate memory for resulting set of solutions
     int n_resulting = (*n_sols)*((*n_sols)-1)/2;
     solution **resulting = safe_malloc(sizeof(solution*)*n_resulting);
+    // Random seed for the random orders of the searches
+    uint64_t seed = 0;
+    if(run->local_search_pr==SWAP_FIRST_IMPROVEMENT) seed = ((uint64_t)rand()<<32)^(uint64_t)rand();
 
-    // Allocate memory for threads and arguments
-    pthread_t *threads = safe_malloc(sizeof(pthread_t)*run->n_threads);
+    // Allocate memory for arguments
+    int next_pair = 0;
     path_relinking_thread_args *targs = safe_malloc(sizeof(path_relinking_thread_args)*run->n_threads);
 
-    // Call all threads to perform local search
     for(int i=0;i<run->n_threads;i++){
         // Set arguments for the thread
         targs[i].thread_id = i;
         targs[i].run = run;
         targs[i].pool = (*sols);
         targs[i].n_pool = (*n_sols);
+        targs[i].next_pair = &next_pair;
+        targs[i].seed = seed;
         targs[i].result = resulting;
+        targs[i].busy_seconds = 0;
         if(run->local_search_pr==SWAP_FIRST_IMPROVEMENT){
             targs[i].shuff = shuffler_init(run->prob->n_facs);
         }else{
             targs[i].shuff = NULL;
         }
-
-        // Create thread
-        int rc = pthread_create(&threads[i],NULL,path_relinking_thread_execution,&targs[i]);
-        if(rc){
-            fprintf(stderr,"ERROR: Error %d on pthread_create\n",rc);
-            exit(1);
-        }
     }
 
-    // Join threads
-    for(int i=0;i<run->n_threads;i++){
-        pthread_join(threads[i],NULL);
-    }
+    // Call all threads to perform path relinking
+    struct timeval job_start;
+    gettimeofday(&job_start,NULL);
+    threadpool_execute(run->pool,path_relinking_thread_execution,targs,sizeof(path_relinking_thread_args));
+    double job_seconds = seconds_since(job_start);
 
     // Free memory
     for(int i=0;i<run->n_threads;i++){
+        add_thread_time(run,i,targs[i].busy_seconds,job_seconds);
         if(targs[i].shuff!=NULL) shuffler_free(targs[i].shuff);
     }
     free(targs);
-    free(threads);
 
     // End measuring time
     clock_t end = clock();
@@ -316,7 +363,14 @@ availmoves *availmoves_init(const problem *prob, const solution *sol, const solu
     for(int k=0;k<sol->n_facs;k++)  used[sol->facs[k]] = 1;
 
     // Restrict movements more if tgt
-    if(tgt){
+    if(tgt && tgt->facs_bits!=NULL){
+        // The bitset of tgt already tells if it has a facility
+        for(int i=0;i<prob->n_facs;i++){
+            int tgt_has = bitset_test(tgt->facs_bits,i);
+            inss[i] = inss[i] && tgt_has; // can only insert if tgt has it
+            rems[i] = rems[i] && !tgt_has; // can only remove if tgt doens't have it
+        }
+    }else if(tgt){
         // Create array to directly know if tgt has a facility
         int *tgt_used = safe_malloc(sizeof(int)*prob->n_facs);
         for(int i=0;i<prob->n_facs;i++) tgt_used[i] = 0;
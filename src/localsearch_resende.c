@@ -128,8 +128,9 @@ void update_structures(
     const problem *prob = run->prob;
 
     int fr    = sol->assigns[u];
-    double d_phi1 = problem_assig_cost(prob,phi1[u],u);
-    double d_phi2 = problem_assig_cost(prob,phi2[u],u);
+    const costval *crow = problem_client_row(prob,u);
+    double d_phi1 = solution_assig_cost(prob,sol,u);
+    double d_phi2 = problem_client_assig_cost(prob,crow,phi2[u],u);
     assert(fr>=0 && avail->used[fr]);
     assert(d_phi2>=d_phi1);
     assert(phi1[u]==fr);
@@ -147,16 +148,25 @@ void update_structures(
     int proximity_mode = 3 * prob->n_facs/sol->n_facs <= avail->n_insertions;
 
     assert(run->precomp->nearly_indexes!=NULL);
+    int nearly_size = run->precomp->nearly_size;
+
+    // The facilities out of the (truncated) proximity list aren't nearer than its last one, so walking the list
+    // finds all the insertions nearer than phi2 only if the last one isn't, otherwise the insertions are enumerated
+    if(proximity_mode && nearly_size<prob->n_facs){
+        int f_last = run->precomp->nearly_indexes[u][nearly_size-1];
+        if(problem_client_assig_cost(prob,crow,f_last,u) < d_phi2) proximity_mode = 0;
+    }
 
     for(int k=0;k<prob->n_facs;k++){
         int fi;
         double d_fi;
 
         if(proximity_mode){
+            if(k >= nearly_size) break;
             fi = run->precomp->nearly_indexes[u][k];
             if(!avail->avail_inss[fi]) continue;
 
-            d_fi = problem_assig_cost(prob,fi,u);
+            d_fi = problem_client_assig_cost(prob,crow,fi,u);
             if(d_fi >= d_phi2) break;
         }else{
             if(k >= avail->n_insertions) break;
@@ -164,7 +174,7 @@ void update_structures(
             fi = avail->insertions[k];
             assert(avail->avail_inss[fi]);
 
-            d_fi = problem_assig_cost(prob,fi,u);
+            d_fi = problem_client_assig_cost(prob,crow,fi,u);
             if(d_fi >= d_phi2) continue;
         }
 
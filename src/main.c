@@ -46,6 +46,11 @@ int main(int argc, const char **argv){
     int branching_correction = UNSET;
     int path_relinking = UNSET;
     int only_1_output_sol = UNSET;
+    int client_major = UNSET;
+    int low_memory = UNSET;
+    int vr_heap_limit_mb = UNSET;
+    int convert = UNSET;
+    int allow_lossy = UNSET;
 
     // Parse arguments
     for(int i=1;i<argc-2;i++){
@@ -90,6 +95,13 @@ int main(int argc, const char **argv){
                    fprintf(stderr,"ERROR: expected number of threads on argument \"%s\".\n",argv[i]);
                    exit(1);
                 }
+            }else if(argv[i][1]=='H'){
+                // Memory limit for the VR-heuristic pairs
+                int n_read = sscanf(argv[i],"-H%d",&vr_heap_limit_mb);
+                if(n_read<1 || vr_heap_limit_mb<0){
+                   fprintf(stderr,"ERROR: expected memory limit in MB on argument \"%s\".\n",argv[i]);
+                   exit(1);
+                }
             }else if(argv[i][1]=='s'){
                 // Minimum solution size
                 int n_read = sscanf(argv[i],"-s%d",&min_size);
@@ -170,6 +182,18 @@ int main(int argc, const char **argv){
                 // Enable path relinking until no better solution is found made
                 assert(path_relinking==UNSET);
                 path_relinking = PATH_RELINKING_UNTIL_NO_BETTER;
+            }else if(argv[i][1]=='T' && strcmp(argv[i],"-T")==0){
+                // Keep a client-major copy of the cost matrix
+                client_major = 1;
+            }else if(argv[i][1]=='m' && strcmp(argv[i],"-m")==0){
+                // Don't cache assignment costs on the solutions
+                low_memory = 1;
+            }else if(argv[i][1]=='C' && strcmp(argv[i],"-C")==0){
+                // Convert the input to the binary format, instead of solving it
+                convert = 1;
+            }else if(argv[i][1]=='F' && strcmp(argv[i],"-F")==0){
+                // Accept costs that lose precision when stored
+                allow_lossy = 1;
             }else if(argv[i][1]=='V' && strcmp(argv[i],"-V")==0){
                 // Non verbose mode
                 verbose = 0;
@@ -183,17 +207,37 @@ int main(int argc, const char **argv){
         }
     }
 
+    if(n_threads<0) n_threads = DEFAULT_THREADS;
+    if(allow_lossy<0) allow_lossy = 0;
+
+    // Save the problem on the binary format and terminate
+    if(convert==1){
+        problem *prob = new_problem_load(input_fname,n_threads,allow_lossy);
+        if(min_size>=0) prob->size_restriction_minimum = min_size;
+        if(max_size>=0) prob->size_restriction_maximum = max_size;
+        problem_save_binary(prob,output_fname);
+        printf("Saved \"%s\" on the binary format.\n",output_fname);
+        problem_free(prob);
+        free(strategy_args);
+        return 0;
+    }
+
     redstrategy *strategies = redstrategy_init_from_nomenclatures(strategy_args,&n_strategies);
 
     // Default values
     if(restarts<0) restarts = 1;
-    if(n_threads<0) n_threads = DEFAULT_THREADS;
     if(verbose<0) verbose = 1;
 
     // Read problem and set size restrictions
-    problem *prob = new_problem_load(input_fname);
+    struct timeval load_start, load_end;
+    gettimeofday(&load_start,NULL);
+    problem *prob = new_problem_load(input_fname,n_threads,allow_lossy);
+    gettimeofday(&load_end,NULL);
     if(min_size>=0) prob->size_restriction_minimum = min_size;
     if(max_size>=0) prob->size_restriction_maximum = max_size;
+    // Build the client-major copy of the costs, before the precomputations that use it
+    if(client_major==1) problem_init_client_major(prob);
+    if(low_memory==1) prob->cache_assign_costs = 0;
 
     // See if the nearly indexes should be precomputed
     int precomp_nearly_indexes = 0;
@@ -209,6 +253,8 @@ int main(int argc, const char **argv){
     // Initialize the rundata and perform the precomputations
     rundata *run = rundata_init(prob, strategies,n_strategies,restarts,precomp_nearly_indexes,n_threads,verbose);
 
+    run->run_inf->load_seconds = get_delta_seconds(load_start,load_end);
+
     // Free problem (rundata kepps a copy)
     problem_free(prob);
     prob = NULL;
@@ -226,6 +272,7 @@ int main(int argc, const char **argv){
     if(verbose!=UNSET) run->verbose = verbose;
     if(branching!=UNSET) run->branching_factor = branching;
     if(path_relinking!=UNSET) run->path_relinking = path_relinking;
+    if(vr_heap_limit_mb!=UNSET) run->vr_heap_limit_mb = vr_heap_limit_mb;
     if(local_search_pr==UNSET){ // If PR local search is unset, make it equal to the normal local search
         if(run->local_search!=NO_LOCAL_SEARCH) run->local_search_pr = run->local_search;
     }else{
@@ -276,19 +323,19 @@ int main(int argc, const char **argv){
 
     if(run->verbose) printf("\n");
 
-    int virt_mem_usage_peak;
-    get_memory_usage(NULL,NULL,NULL,&virt_mem_usage_peak);
+    int virt_mem_usage_peak, real_mem_usage_peak;
+    get_memory_usage(NULL,&real_mem_usage_peak,NULL,&virt_mem_usage_peak);
 
     // Save output
     save_solutions(output_fname,
         run,final_sols,final_n_sols,input_fname,
-        seconds,elapsed_seconds,virt_mem_usage_peak,
+        seconds,elapsed_seconds,virt_mem_usage_peak,real_mem_usage_peak,
         strategies,n_strategies, only_1_output_sol);
 
     // Print output
     save_solutions(NULL,
         run,final_sols,final_n_sols,input_fname,
-        seconds,elapsed_seconds,virt_mem_usage_peak,
+        seconds,elapsed_seconds,virt_mem_usage_peak,real_mem_usage_peak,
         strategies,n_strategies, only_1_output_sol);
 
     // Free memory
@@ -0,0 +1,644 @@
+#include "load.h"
+#include "problem.h"
+#include "solution.h"
+#include "rundata.h"
+#include "reduction.h"
+
+/*
+The bench is a program to measure the performance of the inner kernels
+of the solver on a given problem, or on a random generated one, so that
+different implementations of them can be compared.
+*/
+
+#include <time.h>
+
+#define BENCH_N_SOLS 64
+#define BENCH_SEED 42
+
+// Wall clock time in seconds
+double bench_now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec+1e-9*ts.tv_nsec;
+}
+
+// Creates a problem with uniform random costs.
+problem *bench_generate_problem(int n_facs, int n_clis){
+    problem *prob = problem_init(n_facs,n_clis);
+    for(int i=0;i<n_facs;i++){
+        prob->facility_cost[i] = rand()%10000;
+        costval *row = problem_assig_row(prob,i);
+        for(int j=0;j<n_clis;j++) row[j] = rand()%1000;
+    }
+    return prob;
+}
+
+// Creates solutions of size p with random facilities.
+solution **bench_random_solutions(const problem *prob, int n_sols, int p){
+    solution **sols = safe_malloc(sizeof(solution *)*n_sols);
+    for(int i=0;i<n_sols;i++){
+        sols[i] = solution_empty(prob);
+        while(sols[i]->n_facs<p && sols[i]->n_facs<prob->n_facs){
+            solution_add(prob,sols[i],rand()%prob->n_facs,NULL);
+        }
+    }
+    return sols;
+}
+
+// ============================================================================
+// Cost matrix layouts
+
+// Previous layout of the cost matrix, an array of separately allocated rows (starting on -1)
+costval **bench_rowpointers_init(const problem *prob){
+    costval **rows = safe_malloc(sizeof(costval*)*(prob->n_facs+1));
+    rows += 1;
+    for(int i=-1;i<prob->n_facs;i++){
+        rows[i] = safe_malloc(sizeof(costval)*prob->n_clis);
+        memcpy(rows[i],problem_assig_row(prob,i),sizeof(costval)*prob->n_clis);
+    }
+    return rows;
+}
+
+void bench_rowpointers_free(const problem *prob, costval **rows){
+    for(int i=-1;i<prob->n_facs;i++) free(rows[i]);
+    free(rows-1);
+}
+
+// Value of each solution after adding each facility, with the cost lookups of the given layout.
+double bench_layout_add_sweep(const problem *prob, costval **rows, solution **sols, int n_sols){
+    double total = 0;
+    for(int i=0;i<n_sols;i++){
+        const solution *sol = sols[i];
+        for(int f=0;f<prob->n_facs;f++){
+            double value = 0;
+            if(rows){
+                const costval *row = rows[f];
+                for(int c=0;c<prob->n_clis;c++){
+                    double pre = rows[sol->assigns[c]][c];
+                    double pos = row[c];
+                    value -= pos<pre? pos : pre;
+                }
+            }else{
+                const costval *row = problem_assig_row(prob,f);
+                for(int c=0;c<prob->n_clis;c++){
+                    double pre = problem_assig_cost(prob,sol->assigns[c],c);
+                    double pos = row[c];
+                    value -= pos<pre? pos : pre;
+                }
+            }
+            total += value;
+        }
+    }
+    return total;
+}
+
+// Per client delta dissimilitude between all pairs of solutions, with the cost lookups of the given layout.
+double bench_layout_pcd(const problem *prob, costval **rows, solution **sols, int n_sols){
+    double total = 0;
+    for(int a=0;a<n_sols;a++){
+        for(int b=a+1;b<n_sols;b++){
+            double dissim = 0;
+            for(int c=0;c<prob->n_clis;c++){
+                double cost_a, cost_b;
+                if(rows){
+                    cost_a = rows[sols[a]->assigns[c]][c];
+                    cost_b = rows[sols[b]->assigns[c]][c];
+                }else{
+                    cost_a = problem_assig_cost(prob,sols[a]->assigns[c],c);
+                    cost_b = problem_assig_cost(prob,sols[b]->assigns[c],c);
+                }
+                double delta = cost_a-cost_b;
+                dissim += delta<0? -delta : delta;
+            }
+            total += dissim;
+        }
+    }
+    return total;
+}
+
+// Compares the row pointers layout against the slab layout.
+void bench_layout(const problem *prob, int p, int reps){
+    solution **sols = bench_random_solutions(prob,BENCH_N_SOLS,p);
+    costval **rows = bench_rowpointers_init(prob);
+    printf("%-12s %-10s %12s %12s\n","kernel","layout","seconds","checksum");
+    for(int k=0;k<2;k++){
+        for(int l=0;l<2;l++){
+            costval **layout_rows = l==0? rows : NULL;
+            double check = 0;
+            double start = bench_now();
+            for(int r=0;r<reps;r++){
+                if(k==0) check += bench_layout_add_sweep(prob,layout_rows,sols,BENCH_N_SOLS);
+                else     check += bench_layout_pcd(prob,layout_rows,sols,BENCH_N_SOLS);
+            }
+            double end = bench_now();
+            printf("%-12s %-10s %12.6f %12.6g\n",k==0? "add_sweep" : "pcd",
+                l==0? "rowptrs" : "slab",end-start,check);
+        }
+    }
+    bench_rowpointers_free(prob,rows);
+    for(int i=0;i<BENCH_N_SOLS;i++) solution_free(sols[i]);
+    free(sols);
+}
+
+// ============================================================================
+// Client-major copy of the cost matrix
+
+// Nearest facility of each client among all facilities, scanning the facilities of each client.
+double bench_transposed_nearest(const problem *prob){
+    double total = 0;
+    for(int c=0;c<prob->n_clis;c++){
+        const costval *crow = problem_client_row(prob,c);
+        double best = problem_client_assig_cost(prob,crow,-1,c);
+        for(int f=0;f<prob->n_facs;f++){
+            double cost = problem_client_assig_cost(prob,crow,f,c);
+            if(cost<best) best = cost;
+        }
+        total += best;
+    }
+    return total;
+}
+
+// Nearest facility of each client among the facilities of each solution, scanning the facilities of each client.
+double bench_transposed_sol_nearest(const problem *prob, solution **sols, int n_sols){
+    double total = 0;
+    for(int i=0;i<n_sols;i++){
+        for(int c=0;c<prob->n_clis;c++){
+            const costval *crow = problem_client_row(prob,c);
+            double best = problem_client_assig_cost(prob,crow,-1,c);
+            for(int k=0;k<sols[i]->n_facs;k++){
+                double cost = problem_client_assig_cost(prob,crow,sols[i]->facs[k],c);
+                if(cost<best) best = cost;
+            }
+            total += best;
+        }
+    }
+    return total;
+}
+
+// Compares the client-wise kernels with and without the client-major copy of the cost matrix.
+void bench_transposed(const problem *prob, int p, int reps){
+    solution **sols = bench_random_solutions(prob,BENCH_N_SOLS,p);
+    problem *prob_t = problem_copy(prob);
+    double start = bench_now();
+    problem_init_client_major(prob_t);
+    printf("client-major copy built in %.6f seconds\n",bench_now()-start);
+    printf("%-12s %-10s %12s %12s\n","kernel","layout","seconds","checksum");
+    for(int k=0;k<2;k++){
+        for(int l=0;l<2;l++){
+            const problem *layout_prob = l==0? prob : prob_t;
+            double check = 0;
+            double start = bench_now();
+            for(int r=0;r<reps;r++){
+                if(k==0) check += bench_transposed_nearest(layout_prob);
+                else     check += bench_transposed_sol_nearest(layout_prob,sols,BENCH_N_SOLS);
+            }
+            double end = bench_now();
+            printf("%-12s %-10s %12.6f %12.6g\n",k==0? "nearest" : "sol_nearest",
+                l==0? "fac-major" : "cli-major",end-start,check);
+        }
+    }
+    problem_free(prob_t);
+    for(int i=0;i<BENCH_N_SOLS;i++) solution_free(sols[i]);
+    free(sols);
+}
+
+// ============================================================================
+// Add sweep kernels
+
+// Previous reassignment sweep of solution_add, gathering the current cost of each client through assigns.
+double bench_add_gather(const problem *prob, facidx *assigns, int f){
+    const costval *row = problem_assig_row(prob,f);
+    double delta = 0;
+    for(int c=0;c<prob->n_clis;c++){
+        double pre = problem_assig_cost(prob,assigns[c],c);
+        if(row[c]<pre){
+            delta += row[c]-pre;
+            assigns[c] = f;
+        }
+    }
+    return delta;
+}
+
+// Compares the gathered reassignment sweep with the scalar and vectorized ones on the cached costs.
+void bench_add(const problem *prob, int p, int reps){
+    solution **sols = bench_random_solutions(prob,BENCH_N_SOLS,p);
+    facidx *assigns = safe_malloc(sizeof(facidx)*prob->n_clis);
+    costval *costs = safe_malloc(sizeof(costval)*prob->n_clis);
+    printf("%-12s %12s %12s\n","kernel","seconds","checksum");
+    for(int k=0;k<4;k++){
+        double check = 0;
+        double start = bench_now();
+        for(int r=0;r<reps;r++){
+            for(int i=0;i<BENCH_N_SOLS;i++){
+                for(int f=0;f<prob->n_facs;f++){
+                    // The value only kernel doesn't need a copy of the solution
+                    if(k==3){
+                        check += kernel_add_delta(prob->n_clis,problem_assig_row(prob,f),sols[i]->assign_costs);
+                        continue;
+                    }
+                    memcpy(assigns,sols[i]->assigns,sizeof(facidx)*prob->n_clis);
+                    memcpy(costs,sols[i]->assign_costs,sizeof(costval)*prob->n_clis);
+                    const costval *row = problem_assig_row(prob,f);
+                    if(k==0)      check += bench_add_gather(prob,assigns,f);
+                    else if(k==1) check += kernel_add_sweep_scalar(prob->n_clis,row,costs,assigns,f);
+                    else          check += kernel_add_sweep(prob->n_clis,row,costs,assigns,f);
+                }
+            }
+        }
+        double end = bench_now();
+        printf("%-12s %12.6f %12.6g\n",k==0? "gather" : (k==1? "scalar" : (k==2? KERNELS_ISA : "value_only")),end-start,check);
+    }
+    free(costs);
+    free(assigns);
+    for(int i=0;i<BENCH_N_SOLS;i++) solution_free(sols[i]);
+    free(sols);
+}
+
+// ============================================================================
+// Per client delta dissimilitude
+
+// Previous per client delta dissimilitude, gathering the cost of each client through the assignments.
+double bench_pcd_gather(const problem *prob, const solution *sol1, const solution *sol2){
+    double total = 0;
+    for(int c=0;c<prob->n_clis;c++){
+        double delta = problem_assig_cost(prob,sol1->assigns[c],c)-problem_assig_cost(prob,sol2->assigns[c],c);
+        total += delta<0? -delta : delta;
+    }
+    return total;
+}
+
+// Compares the gathered per client delta dissimilitude with the scalar and vectorized L1 kernels
+// on the cached assignment costs, between all the pairs of solutions.
+void bench_pcd(const problem *prob, int p, int reps){
+    solution **sols = bench_random_solutions(prob,BENCH_N_SOLS,p);
+    printf("%-12s %12s %12s\n","kernel","seconds","checksum");
+    for(int k=0;k<3;k++){
+        double check = 0;
+        double start = bench_now();
+        for(int r=0;r<reps;r++){
+            for(int a=0;a<BENCH_N_SOLS;a++){
+                for(int b=a+1;b<BENCH_N_SOLS;b++){
+                    if(k==0)      check += bench_pcd_gather(prob,sols[a],sols[b]);
+                    else if(k==1) check += kernel_l1_distance_scalar(prob->n_clis,sols[a]->assign_costs,sols[b]->assign_costs);
+                    else          check += kernel_l1_distance(prob->n_clis,sols[a]->assign_costs,sols[b]->assign_costs);
+                }
+            }
+        }
+        double end = bench_now();
+        printf("%-12s %12.6f %12.6g\n",k==0? "gather" : (k==1? "scalar" : kernel_l1_isa()),end-start,check);
+    }
+    for(int i=0;i<BENCH_N_SOLS;i++) solution_free(sols[i]);
+    free(sols);
+}
+
+// ============================================================================
+// Facility sets
+
+// Compares the merge of the sorted facilities with the bitsets, for the number of different indexes
+// between all the pairs of solutions and for the equality between each solution and a copy of it.
+void bench_facsets(problem *prob, int p, int reps){
+    prob->cache_facs_bits = 1;
+    solution **sols = bench_random_solutions(prob,BENCH_N_SOLS,p);
+    solution **copies = safe_malloc(sizeof(solution *)*BENCH_N_SOLS);
+    for(int i=0;i<BENCH_N_SOLS;i++) copies[i] = solution_copy(prob,sols[i]);
+    printf("%-12s %12s %12s %12s\n","facsets","diff_secs","equal_secs","checksum");
+    for(int k=0;k<2;k++){
+        double check = 0;
+        double start = bench_now();
+        for(int r=0;r<reps;r++){
+            for(int a=0;a<BENCH_N_SOLS;a++){
+                for(int b=a+1;b<BENCH_N_SOLS;b++){
+                    if(k==0) check += diff_sorted(sols[a]->facs,sols[a]->n_facs,sols[b]->facs,sols[b]->n_facs);
+                    else     check += bitset_diff(sols[a]->facs_bits,sols[b]->facs_bits,sols[a]->facs_words);
+                }
+            }
+        }
+        double mid = bench_now();
+        // Without the bitsets solutionp_facs_cmp merges the facilities
+        uint64_t *bits[BENCH_N_SOLS];
+        for(int i=0;i<BENCH_N_SOLS && k==0;i++){
+            bits[i] = copies[i]->facs_bits;
+            copies[i]->facs_bits = NULL;
+        }
+        for(int r=0;r<reps*BENCH_N_SOLS/2;r++){
+            for(int a=0;a<BENCH_N_SOLS;a++){
+                check += solutionp_facs_cmp(&sols[a],&copies[a])==0;
+            }
+        }
+        for(int i=0;i<BENCH_N_SOLS && k==0;i++) copies[i]->facs_bits = bits[i];
+        double end = bench_now();
+        printf("%-12s %12.6f %12.6f %12.6g\n",k==0? "sorted" : "bitset",mid-start,end-mid,check);
+    }
+    for(int i=0;i<BENCH_N_SOLS;i++){
+        solution_free(sols[i]);
+        solution_free(copies[i]);
+    }
+    free(copies);
+    free(sols);
+}
+
+// ============================================================================
+// Facility-facility distances
+
+// Previous facility-facility distance precomputation, comparing the full rows of each pair of facilities.
+double **bench_facdist_naive(const problem *prob, facdismode mode){
+    double **dists = safe_malloc(sizeof(double *)*prob->n_facs);
+    for(int a=0;a<prob->n_facs;a++) dists[a] = safe_malloc(sizeof(double)*prob->n_facs);
+    for(int a=0;a<prob->n_facs;a++){
+        const costval *row_a = problem_assig_row(prob,a);
+        for(int b=a;b<prob->n_facs;b++){
+            const costval *row_b = problem_assig_row(prob,b);
+            double dist = mode==FACDIS_SUM_OF_DELTAS? 0 : INFINITY;
+            for(int j=0;j<prob->n_clis;j++){
+                if(mode==FACDIS_SUM_OF_DELTAS){
+                    double delta = row_a[j]-row_b[j];
+                    dist += delta<0? -delta : delta;
+                }else{
+                    double dist_sum = row_a[j]+row_b[j];
+                    if(dist_sum<dist) dist = dist_sum;
+                }
+            }
+            dists[a][b] = dist;
+            dists[b][a] = dist;
+        }
+    }
+    return dists;
+}
+
+// Compares the previous facility-facility distance precomputation with the tiled one of runprecomp
+// (on a single thread, including the lists of nearest facilities), and the largest difference between them.
+void bench_facdist(problem *prob, int p, int reps){
+    threadpool *pool = threadpool_init(1);
+    printf("%-12s %-10s %12s %12s\n","facdis","precomp","seconds","max_diff");
+    for(int d=0;d<2;d++){
+        redstrategy rstrat = redstrategy_from_nomenclature(d==0? "sdbs+:2:mgesum" : "sdbs+:2:mgemin");
+        facdismode mode = rstrat.facdis;
+        double seconds_naive = 0;
+        double seconds_tiled = 0;
+        double max_diff = 0;
+        for(int r=0;r<reps;r++){
+            double start = bench_now();
+            double **naive = bench_facdist_naive(prob,mode);
+            double mid = bench_now();
+            runprecomp *pcomp = runprecomp_init(prob,&rstrat,1,0,pool,0);
+            double end = bench_now();
+            seconds_naive += mid-start;
+            seconds_tiled += end-mid;
+            for(int a=0;a<prob->n_facs;a++){
+                for(int b=0;b<prob->n_facs;b++){
+                    double diff = fabs(naive[a][b]-pcomp->facs_distance[mode][a][b]);
+                    if(diff>max_diff) max_diff = diff;
+                }
+                free(naive[a]);
+            }
+            free(naive);
+            runprecomp_free(pcomp);
+        }
+        const char *name = d==0? "sum" : "min";
+        printf("%-12s %-10s %12.6f\n",name,"naive",seconds_naive);
+        printf("%-12s %-10s %12.6f %12.6g\n",name,"tiled",seconds_tiled,max_diff);
+    }
+    threadpool_free(pool);
+}
+
+// ============================================================================
+// Nearly indexes
+
+// Compares sorting all the facilities for each client (previous nearly indexes) with the truncated lists of runprecomp
+// (on a single thread), and the memory of both.
+int bench_nearly_cmp(const void *a, const void *b){
+    const costval *ca = *(const costval **)a;
+    const costval *cb = *(const costval **)b;
+    return (*ca>*cb) - (*ca<*cb);
+}
+
+void bench_nearly(problem *prob, int p, int reps){
+    problem_init_client_major(prob);
+    threadpool *pool = threadpool_init(1);
+    double seconds_full = 0;
+    double seconds_trunc = 0;
+    long long int check = 0;
+    int size = 0;
+    const costval **ptrs = safe_malloc(sizeof(costval *)*prob->n_facs);
+    int *full = safe_malloc(sizeof(int)*prob->n_facs);
+    for(int r=0;r<reps;r++){
+        double start = bench_now();
+        for(int c=0;c<prob->n_clis;c++){
+            const costval *crow = problem_client_row(prob,c);
+            for(int f=0;f<prob->n_facs;f++) ptrs[f] = &crow[f];
+            qsort(ptrs,prob->n_facs,sizeof(costval *),bench_nearly_cmp);
+            for(int f=0;f<prob->n_facs;f++) full[f] = ptrs[f]-crow;
+            check += full[0];
+        }
+        double mid = bench_now();
+        runprecomp *pcomp = runprecomp_init(prob,NULL,0,1,pool,0);
+        double end = bench_now();
+        size = pcomp->nearly_size;
+        for(int c=0;c<prob->n_clis;c++) check -= pcomp->nearly_indexes[c][0];
+        runprecomp_free(pcomp);
+        seconds_full += mid-start;
+        seconds_trunc += end-mid;
+    }
+    printf("%-12s %8s %12s %12s\n","nearly","size","seconds","MB");
+    printf("%-12s %8d %12.6f %12.1f\n","full",prob->n_facs,seconds_full,sizeof(int)*(double)prob->n_facs*prob->n_clis/1e6);
+    printf("%-12s %8d %12.6f %12.1f\n","truncated",size,seconds_trunc,sizeof(facidx)*(double)size*prob->n_clis/1e6);
+    printf("differences on the nearest facility: %lld\n",check);
+    free(full);
+    free(ptrs);
+    threadpool_free(pool);
+}
+
+// ============================================================================
+// Facility distance dissimilitudes
+
+// Compares the mean geometric error and Hausdorff dissimilitudes between all the pairs of solutions,
+// scanning the facilities of the other solution and walking the lists of nearest facilities.
+void bench_mge(problem *prob, int p, int reps){
+    prob->cache_facs_bits = 1;
+    const char *noms[] = {"sdbs+:2:mgesum","sdbs+:1:mgemin"};
+    int n_noms = 2;
+    redstrategy *rstrats = redstrategy_init_from_nomenclatures(noms,&n_noms);
+    rundata *run = rundata_init(prob,rstrats,n_noms,1,0,1,0);
+    solution **sols = bench_random_solutions(prob,BENCH_N_SOLS,p);
+    printf("%-12s %-10s %12s %12s\n","dissimil","search","seconds","checksum");
+    for(int d=0;d<3;d++){
+        soldismode sdismode = d<2? SOLDIS_MEAN_GEOMETRIC_ERROR : SOLDIS_HAUSDORF;
+        facdismode fdismode = d==1? FACDIS_MIN_TRIANGLE : FACDIS_SUM_OF_DELTAS;
+        int *neighbors = run->precomp->facs_neighbors[fdismode];
+        for(int k=0;k<2;k++){
+            // Without the lists the dissimilitudes scan the solutions
+            run->precomp->facs_neighbors[fdismode] = k==0? NULL : neighbors;
+            double check = 0;
+            double start = bench_now();
+            for(int r=0;r<reps;r++){
+                for(int a=0;a<BENCH_N_SOLS;a++){
+                    for(int b=a+1;b<BENCH_N_SOLS;b++){
+                        check += solution_dissimilitude(run,sols[a],sols[b],sdismode,fdismode);
+                    }
+                }
+            }
+            double end = bench_now();
+            printf("%-12s %-10s %12.6f %12.10g\n",d==0? "mgesum" : (d==1? "mgemin" : "hausum"),
+                k==0? "scan" : "neighbors",end-start,check);
+        }
+        run->precomp->facs_neighbors[fdismode] = neighbors;
+    }
+    for(int i=0;i<BENCH_N_SOLS;i++) solution_free(sols[i]);
+    free(sols);
+    rundata_free(run);
+    free(rstrats);
+}
+
+// ============================================================================
+// Diversity reduction
+
+#define BENCH_SDBS_N_SOLS 3000
+#define BENCH_SDBS_TARGET 200
+#define BENCH_SDBS_MAX_THREADS 64
+
+// Measures the sdbs+ reduction (per client delta) of random solutions, from 1 to BENCH_SDBS_MAX_THREADS threads.
+void bench_sdbs(problem *prob, int p, int reps){
+    solution **sols = bench_random_solutions(prob,BENCH_SDBS_N_SOLS,p);
+    solution **work = safe_malloc(sizeof(solution *)*BENCH_SDBS_N_SOLS);
+    char nomenclature[64];
+    sprintf(nomenclature,"sdbs+:%d:pcd",BENCH_SDBS_TARGET);
+    redstrategy rstrat = redstrategy_from_nomenclature(nomenclature);
+    printf("%d solutions to %d\n",BENCH_SDBS_N_SOLS,BENCH_SDBS_TARGET);
+    printf("%-12s %12s %12s\n","threads","seconds","checksum");
+    for(int t=1;t<=BENCH_SDBS_MAX_THREADS;t*=2){
+        rundata *run = rundata_init(prob,&rstrat,1,1,0,t,0);
+        double seconds = 0;
+        double check = 0;
+        for(int r=0;r<reps;r++){
+            for(int i=0;i<BENCH_SDBS_N_SOLS;i++) work[i] = solution_copy(prob,sols[i]);
+            int n_work = BENCH_SDBS_N_SOLS;
+            double start = bench_now();
+            reduce_by_redstrategy(run,rstrat,work,&n_work);
+            seconds += bench_now()-start;
+            for(int i=0;i<n_work;i++){
+                check += work[i]->value;
+                solution_free(work[i]);
+            }
+        }
+        printf("%-12d %12.6f %12.6g\n",t,seconds,check);
+        rundata_free(run);
+    }
+    free(work);
+    for(int i=0;i<BENCH_SDBS_N_SOLS;i++) solution_free(sols[i]);
+    free(sols);
+}
+
+// ============================================================================
+// Sketch dissimilitude
+
+// Measures the sdbs+ reduction of random solutions with the exact per client delta dissimilitude and with
+// sketches of several sizes (including the time to compute them), and the quality of the selected solutions:
+// the mean and maximum exact dissimilitude of each solution to the nearest selected one.
+void bench_sketch(problem *prob, int p, int reps){
+    const char *dissims[] = {"pcd","rpcd16","rpcd32","rpcd64","rpcd128","rpcd256"};
+    int n_dissims = sizeof(dissims)/sizeof(dissims[0]);
+    solution **sols = bench_random_solutions(prob,BENCH_SDBS_N_SOLS,p);
+    solution **work = safe_malloc(sizeof(solution *)*BENCH_SDBS_N_SOLS);
+    printf("%d solutions to %d\n",BENCH_SDBS_N_SOLS,BENCH_SDBS_TARGET);
+    printf("%-12s %12s %14s %14s\n","dissimilitude","seconds","mean_nearest","max_nearest");
+    for(int d=0;d<n_dissims;d++){
+        char nomenclature[64];
+        sprintf(nomenclature,"sdbs+:%d:%s",BENCH_SDBS_TARGET,dissims[d]);
+        redstrategy rstrat = redstrategy_from_nomenclature(nomenclature);
+        rundata *run = rundata_init(prob,&rstrat,1,1,0,1,0);
+        double seconds = 0;
+        double mean_nearest = 0;
+        double max_nearest = 0;
+        for(int r=0;r<reps;r++){
+            for(int i=0;i<BENCH_SDBS_N_SOLS;i++) work[i] = solution_copy(prob,sols[i]);
+            int n_work = BENCH_SDBS_N_SOLS;
+            double start = bench_now();
+            reduce_by_redstrategy(run,rstrat,work,&n_work);
+            seconds += bench_now()-start;
+            // Exact dissimilitude of each solution to the nearest selected one
+            for(int i=0;i<BENCH_SDBS_N_SOLS;i++){
+                double nearest = INFINITY;
+                for(int j=0;j<n_work;j++){
+                    double dissim = kernel_l1_distance(prob->n_clis,sols[i]->assign_costs,work[j]->assign_costs);
+                    if(dissim<nearest) nearest = dissim;
+                }
+                mean_nearest += nearest/(BENCH_SDBS_N_SOLS*reps);
+                if(nearest>max_nearest) max_nearest = nearest;
+            }
+            for(int i=0;i<n_work;i++) solution_free(work[i]);
+        }
+        printf("%-12s %12.6f %14.6g %14.6g\n",dissims[d],seconds,mean_nearest,max_nearest);
+        rundata_free(run);
+    }
+    free(work);
+    for(int i=0;i<BENCH_SDBS_N_SOLS;i++) solution_free(sols[i]);
+    free(sols);
+}
+
+// ============================================================================
+
+int main(int argc, const char **argv){
+    // Print information if arguments are invalid
+    if(argc<3){
+        fprintf(stderr,"usage: %s <mode> {<input> | -g <n> <m>} [p] [reps]\n",argv[0]);
+        fprintf(stderr,"modes:\n");
+        fprintf(stderr,"  layout      cost matrix layouts on the add sweep and pcd kernels.\n");
+        fprintf(stderr,"  transposed  client-wise kernels with and without the client-major copy.\n");
+        fprintf(stderr,"  add         reassignment sweep of solution_add, gathered, scalar, vectorized and value only.\n");
+        fprintf(stderr,"  pcd         per client delta dissimilitude, gathered, scalar and vectorized.\n");
+        fprintf(stderr,"  facsets     index difference and equality of solutions, merging sorted facilities and with bitsets.\n");
+        fprintf(stderr,"  facdist     facility-facility distance precomputation, naive and tiled.\n");
+        fprintf(stderr,"  nearly      nearest facilities of each client, full sort and truncated lists.\n");
+        fprintf(stderr,"  mge         mge and hausdorff dissimilitudes, scanning solutions and with lists of nearest facilities.\n");
+        fprintf(stderr,"  sdbs        diversity reduction of random solutions from 1 to %d threads.\n",BENCH_SDBS_MAX_THREADS);
+        fprintf(stderr,"  sketch      diversity reduction of random solutions with pcd and with sketches, time and quality.\n");
+        exit(1);
+    }
+    const char *mode = argv[1];
+    srand(BENCH_SEED);
+
+    // Read or generate problem
+    problem *prob;
+    int argi;
+    if(strcmp(argv[2],"-g")==0){
+        if(argc<5){
+            fprintf(stderr,"ERROR: expected <n> <m> after -g.\n");
+            exit(1);
+        }
+        prob = bench_generate_problem(atoi(argv[3]),atoi(argv[4]));
+        argi = 5;
+    }else{
+        prob = new_problem_load(argv[2],1,1); // Only timed, so costs may lose precision
+        argi = 3;
+    }
+    int p    = argc>argi?   atoi(argv[argi])   : 10;
+    int reps = argc>argi+1? atoi(argv[argi+1]) : 1;
+    printf("n: %d m: %d p: %d reps: %d\n",prob->n_facs,prob->n_clis,p,reps);
+
+    if(strcmp(mode,"layout")==0){
+        bench_layout(prob,p,reps);
+    }else if(strcmp(mode,"transposed")==0){
+        bench_transposed(prob,p,reps);
+    }else if(strcmp(mode,"add")==0){
+        bench_add(prob,p,reps);
+    }else if(strcmp(mode,"pcd")==0){
+        bench_pcd(prob,p,reps);
+    }else if(strcmp(mode,"facsets")==0){
+        bench_facsets(prob,p,reps);
+    }else if(strcmp(mode,"facdist")==0){
+        bench_facdist(prob,p,reps);
+    }else if(strcmp(mode,"nearly")==0){
+        bench_nearly(prob,p,reps);
+    }else if(strcmp(mode,"mge")==0){
+        bench_mge(prob,p,reps);
+    }else if(strcmp(mode,"sdbs")==0){
+        bench_sdbs(prob,p,reps);
+    }else if(strcmp(mode,"sketch")==0){
+        bench_sketch(prob,p,reps);
+    }else{
+        fprintf(stderr,"ERROR: bench mode \"%s\" not recognized.\n",mode);
+        exit(1);
+    }
+
+    problem_free(prob);
+}
@@ -51,7 +51,7 @@ int main(int argc, const char **argv){
     const char *opt_fname = argv[2];
 
     // Read problem
-    problem *prob = new_problem_load(input_fname);
+    problem *prob = new_problem_load(input_fname,1,0);
 
     // Create empty solution
     solution *solution = solution_empty(prob);
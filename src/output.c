@@ -12,7 +12,7 @@ float get_delta_seconds(struct timeval tv1, struct timeval tv2){
 
 void save_solutions(const char *file,
         const rundata *run, solution **sols, int n_sols,
-        const char *input_file, float seconds, float elapsed, int mem_usage,
+        const char *input_file, float seconds, float elapsed, int mem_usage, int real_mem_usage,
         const redstrategy *strategies, int n_strategies, int only_1_output_sol){
     FILE *fp;
     // Open output file
@@ -38,8 +38,15 @@ void save_solutions(const char *file,
     fprintf(fp,"# INPUT_FILE: \"%s\"\n",input_file);
     fprintf(fp,"# CPU_TIME: %f\n",seconds);
     fprintf(fp,"# ELAPSED: %f\n",elapsed);
+    fprintf(fp,"# LOAD_TIME: %f\n",run->run_inf->load_seconds);
     fprintf(fp,"# VIRT_MEM_PEAK_KB: %d\n",mem_usage);
+    fprintf(fp,"# REAL_MEM_PEAK_KB: %d\n",real_mem_usage);
     fprintf(fp,"# TOTAL_ITERATIONS: %d\n",run->run_inf->total_n_iterations);
+    fprintf(fp,"# EXPANSION_TIME: %f\n",run->run_inf->expansion_seconds);
+    fprintf(fp,"# EXPANSION_EVALUATED_CHILDREN: %lld\n",run->run_inf->n_children_evaluated);
+    fprintf(fp,"# EXPANSION_MATERIALIZED_CHILDREN: %lld\n",run->run_inf->n_children_materialized);
+    fprintf(fp,"# SDBS_DISSIMILITUDES: %lld\n",run->run_inf->n_sdbs_dissimilitudes);
+    fprintf(fp,"# SDBS_DISSIMILITUDES_SAVED: %lld\n",run->run_inf->n_sdbs_dissimilitudes_saved);
     fprintf(fp,"\n");
 
     /* LOCAL SEARCH INFO */
@@ -47,6 +54,13 @@ void save_solutions(const char *file,
     fprintf(fp,"# LOCAL_SEARCH_CPU_TIME: %f\n",run->run_inf->local_search_seconds);
     fprintf(fp,"# N_LOCAL_SEARCHES: %lld\n",run->run_inf->n_local_searches);
     fprintf(fp,"# AVG_LOCAL_SEARCH_MOVES: %f\n",(double)run->run_inf->n_local_search_movements/(double)run->run_inf->n_local_searches);
+    // Per thread times on local searches and path relinking
+    fprintf(fp,"# THREAD_BUSY_TIME:");
+    for(int i=0;i<run->run_inf->n_threads;i++) fprintf(fp," %f",run->run_inf->thread_busy_seconds[i]);
+    fprintf(fp,"\n");
+    fprintf(fp,"# THREAD_IDLE_TIME:");
+    for(int i=0;i<run->run_inf->n_threads;i++) fprintf(fp," %f",run->run_inf->thread_idle_seconds[i]);
+    fprintf(fp,"\n");
     fprintf(fp,"\n");
 
     /* PATH RELINKING INFO */
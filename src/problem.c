@@ -1,55 +1,161 @@
 #include "problem.h"
 
-problem *problem_init(int n_facs, int n_clis){
+#include <unistd.h>
+#include <sys/mman.h>
+
+// Allocates a problem and initializes its fields, except the facility costs and the cost matrix.
+static problem *problem_alloc(int n_facs, int n_clis){
+    if(n_facs>FACIDX_MAX){
+        fprintf(stderr,"ERROR: %d facilities can't be stored as %s facility indexes, use a build without -D FACIDX_16.\n",
+            n_facs,FACIDX_NAME);
+        exit(1);
+    }
     problem *prob = safe_malloc(sizeof(problem));
     prob->n_facs = n_facs;
     prob->n_clis = n_clis;
+    // Pad the rows so that each one starts on an aligned address
+    prob->cli_stride = problem_row_stride(prob->n_clis);
+    // The client-major copy is only built on request
+    prob->distance_cost_t = NULL;
+    prob->fac_stride = 0;
+    // Costs are lossless until one of them isn't
+    prob->lossless_costs = 1;
+    prob->exact_cost = NULL;
+    // Solutions cache their assignment costs by default
+    prob->cache_assign_costs = 1;
+    // Solutions keep a bitset of their facilities unless it would be larger than their assignments
+    prob->cache_facs_bits = sizeof(uint64_t)*bitset_words(n_facs) <= sizeof(facidx)*n_clis;
+
+    prob->size_restriction_minimum = -1;
+    prob->size_restriction_maximum = -1;
+
+    prob->mapping = NULL;
+    prob->mapping_size = 0;
+    prob->mapping_fd = -1;
+    return prob;
+}
+
+problem *problem_init(int n_facs, int n_clis){
+    problem *prob = problem_alloc(n_facs,n_clis);
     //
     prob->facility_cost = safe_malloc(sizeof(double)*prob->n_facs);
     memset(prob->facility_cost,0,     sizeof(double)*prob->n_facs);
-    // Initialize distance cost matrix with rows starting from -1
-    prob->distance_cost = safe_malloc(sizeof(double*)*(prob->n_facs+1));
-    prob->distance_cost += 1;
+    // Initialize distance cost matrix with rows starting from -1, in a single slab
+    size_t slab_size = sizeof(costval)*(size_t)prob->cli_stride*(prob->n_facs+1);
+    costval *slab = safe_aligned_malloc(PROBLEM_ROW_ALIGNMENT,slab_size);
+    memset(slab,0,slab_size);
+    prob->distance_cost = slab+prob->cli_stride;
     // Initialize row -1
-    prob->distance_cost[-1] = safe_malloc(sizeof(double)*prob->n_clis);
-    for(int j=0;j<prob->n_clis;j++) prob->distance_cost[-1][j] = INFINITY;
-    // Initialize other rrows
-    for(int i=0;i<prob->n_facs;i++){
-        prob->distance_cost[i] = safe_malloc(sizeof(double)*prob->n_clis);
-        memset(prob->distance_cost[i],0,     sizeof(double)*prob->n_clis);
+    costval *unassigned_row = problem_assig_row(prob,-1);
+    for(int j=0;j<prob->n_clis;j++) unassigned_row[j] = INFINITY;
+    #ifdef PROBLEM_EXACT_COSTS
+        prob->exact_cost = safe_malloc(sizeof(double)*(size_t)prob->n_facs*prob->n_clis);
+        memset(prob->exact_cost,0,     sizeof(double)*(size_t)prob->n_facs*prob->n_clis);
+    #endif
+    return prob;
+}
+
+problem *problem_init_mapped(int n_facs, int n_clis, int fd, size_t map_size, size_t facility_cost_offset, size_t distance_cost_offset){
+    assert(facility_cost_offset%PROBLEM_ROW_ALIGNMENT==0 && distance_cost_offset%PROBLEM_ROW_ALIGNMENT==0);
+    problem *prob = problem_alloc(n_facs,n_clis);
+    assert(facility_cost_offset+sizeof(double)*n_facs<=map_size);
+    assert(distance_cost_offset+sizeof(costval)*(size_t)prob->cli_stride*(n_facs+1)<=map_size);
+    void *mapping = mmap(NULL,map_size,PROT_READ|PROT_WRITE,MAP_PRIVATE,fd,0);
+    if(mapping==MAP_FAILED){
+        fprintf(stderr,"ERROR: couldn't map the problem file (%lu B): %s\n",map_size,strerror(errno));
+        exit(1);
     }
+    prob->mapping = mapping;
+    prob->mapping_size = map_size;
+    prob->mapping_fd = fd;
+    prob->facility_cost = (double *)((char *)mapping+facility_cost_offset);
+    prob->distance_cost = (costval *)((char *)mapping+distance_cost_offset)+prob->cli_stride;
+    return prob;
+}
 
-    prob->size_restriction_minimum = -1;
-    prob->size_restriction_maximum = -1;
+// Allocates the client-major matrix, with the cost of facility -1 before each client row.
+static void problem_alloc_client_major(problem *prob){
+    if(prob->distance_cost_t!=NULL) free(prob->distance_cost_t-1);
+    // Pad the client rows so that each one starts on an aligned address (before the -1 entry)
+    prob->fac_stride = problem_row_stride(prob->n_facs+1);
+    size_t slab_size = sizeof(costval)*(size_t)prob->fac_stride*prob->n_clis;
+    costval *slab = safe_aligned_malloc(PROBLEM_ROW_ALIGNMENT,slab_size);
+    memset(slab,0,slab_size);
+    prob->distance_cost_t = slab+1;
+}
 
-    return prob;
+void problem_init_client_major(problem *prob){
+    problem_alloc_client_major(prob);
+    // Transpose in tiles so that both matrices are accessed within cache lines
+    const int tile = 64;
+    for(int i0=-1;i0<prob->n_facs;i0+=tile){
+        int i1 = i0+tile<prob->n_facs? i0+tile : prob->n_facs;
+        for(int j0=0;j0<prob->n_clis;j0+=tile){
+            int j1 = j0+tile<prob->n_clis? j0+tile : prob->n_clis;
+            for(int i=i0;i<i1;i++){
+                const costval *row = problem_assig_row(prob,i);
+                for(int j=j0;j<j1;j++){
+                    prob->distance_cost_t[(long)j*prob->fac_stride+i] = row[j];
+                }
+            }
+        }
+    }
 }
 
 problem *problem_copy(const problem *other){
-    problem *prob = problem_init(other->n_facs,other->n_clis);
+    problem *prob;
+    if(other->mapping!=NULL){
+        // Map the same file again, so that the costs aren't copied
+        int fd = dup(other->mapping_fd);
+        if(fd<0){
+            fprintf(stderr,"ERROR: couldn't duplicate the problem file descriptor: %s\n",strerror(errno));
+            exit(1);
+        }
+        prob = problem_init_mapped(other->n_facs,other->n_clis,fd,other->mapping_size,
+            (char *)other->facility_cost-(char *)other->mapping,
+            (char *)problem_assig_row(other,-1)-(char *)other->mapping);
+    }else{
+        prob = problem_init(other->n_facs,other->n_clis);
+    }
     //
     prob->size_restriction_minimum = other->size_restriction_minimum;
     prob->size_restriction_maximum = other->size_restriction_maximum;
+    prob->lossless_costs = other->lossless_costs;
+    prob->cache_assign_costs = other->cache_assign_costs;
+    prob->cache_facs_bits = other->cache_facs_bits;
     //
-    memcpy(prob->facility_cost,other->facility_cost,sizeof(double)*prob->n_facs);
-    //
-    for(int i=0;i<prob->n_facs;i++){
-        for(int j=0;j<prob->n_clis;j++){
-            prob->distance_cost[i][j] = other->distance_cost[i][j];
-        }
+    if(other->mapping==NULL){
+        memcpy(prob->facility_cost,other->facility_cost,sizeof(double)*prob->n_facs);
+        // Both slabs have the same stride, so they can be copied at once
+        assert(prob->cli_stride==other->cli_stride);
+        memcpy(problem_assig_row(prob,0),problem_assig_row(other,0),
+            sizeof(costval)*(size_t)prob->cli_stride*prob->n_facs);
+    }
+    if(other->exact_cost!=NULL && prob->exact_cost!=NULL){
+        memcpy(prob->exact_cost,other->exact_cost,sizeof(double)*(size_t)prob->n_facs*prob->n_clis);
+    }
+    // Copy the client-major matrix too, if present
+    if(other->distance_cost_t!=NULL){
+        problem_alloc_client_major(prob);
+        memcpy(prob->distance_cost_t-1,other->distance_cost_t-1,
+            sizeof(costval)*(size_t)prob->fac_stride*prob->n_clis);
     }
     return prob;
 }
 
 void problem_free(problem *prob){
-    // Free facility-client distances
-    for(int i=-1;i<prob->n_facs;i++){
-        free(prob->distance_cost[i]);
+    if(prob->mapping!=NULL){
+        // Both the facility costs and the distances slab are on the mapping
+        munmap(prob->mapping,prob->mapping_size);
+        close(prob->mapping_fd);
+    }else{
+        // Free facility-client distances slab (starts on row -1)
+        free(problem_assig_row(prob,-1));
+        // Free per facility and client arrays
+        free(prob->facility_cost);
     }
-    free(prob->distance_cost-1);
-    // Free per facility and client arrays
-    free(prob->facility_cost);
+    if(prob->distance_cost_t!=NULL) free(prob->distance_cost_t-1);
+    if(prob->exact_cost!=NULL) free(prob->exact_cost);
     // Free problem
     free(prob);
 }
-
@@ -4,31 +4,136 @@
 #include "utils.h"
 #include "redstrategy.h"
 
+// Alignment (in bytes) of each row of the cost matrix, enough for 512-bit SIMD loads.
+#define PROBLEM_ROW_ALIGNMENT 64
+
+// Type used to store the assignment costs, compile with -D COST_FLOAT to halve the cost matrix size and bandwidth.
+// Values of solutions are still accumulated on double.
+#ifdef COST_FLOAT
+    typedef float costval;
+    #define COSTVAL_NAME "float"
+#else
+    typedef double costval;
+    #define COSTVAL_NAME "double"
+#endif
+
+// Type used to store facility indexes (the assignments of each solution and the nearly indexes), compile with
+// -D FACIDX_16 to halve their memory. It is signed so that -1 (no facility) is stored as is,
+// problems with more than FACIDX_MAX facilities are rejected when loaded.
+#ifdef FACIDX_16
+    typedef int16_t facidx;
+    #define FACIDX_MAX INT16_MAX
+    #define FACIDX_NAME "int16"
+#else
+    typedef int facidx;
+    #define FACIDX_MAX INT_MAX
+    #define FACIDX_NAME "int"
+#endif
+
+// DEBUG builds that can round the costs keep them with full precision too, to check the values of the solutions.
+#if defined(DEBUG) && defined(COST_FLOAT)
+    #define PROBLEM_EXACT_COSTS
+#endif
+
 typedef struct {
     // | Number of facilities and clients.
     int n_facs, n_clis;
     // | Cost of each facility.
     double *facility_cost;
-    // | Cost matrix between facilities and clients.
-    double **distance_cost;
+    /* | Cost matrix between facilities and clients, stored row-major in a single aligned slab.
+    It points to the row of facility 0, the row of facility -1 (all INFINITY) is placed just before it. */
+    costval *distance_cost;
+    // | Distance between consecutive rows of distance_cost, n_clis padded to PROBLEM_ROW_ALIGNMENT.
+    int cli_stride;
+    /* | Optional client-major copy of distance_cost (NULL if not built), for scans over the facilities of a client.
+    It points to the cost of facility 0 for client 0, the cost for facility -1 (INFINITY) is placed just before it. */
+    costval *distance_cost_t;
+    // | Distance between consecutive client rows of distance_cost_t.
+    int fac_stride;
+    // | If every cost was stored in distance_cost without losing precision.
+    int lossless_costs;
+    /* | Full precision copy of distance_cost (n_facs rows of n_clis doubles), only kept if PROBLEM_EXACT_COSTS is defined
+    and the problem isn't mapped, NULL otherwise. */
+    double *exact_cost;
+    // | If solutions keep a copy of the cost of each of their assignments, faster but doubles their memory.
+    int cache_assign_costs;
+    // | If solutions keep a bitset of their facilities, to compare them faster.
+    int cache_facs_bits;
     // | Unless it is -1, the solutions retrieved must be of this size or larger.
     int size_restriction_minimum;
     // | Unless it is -1, the solutions retrieved must be of this size or smaller.
     int size_restriction_maximum;
+    /* | Memory mapping of a binary problem file (NULL if the arrays are allocated), facility_cost and the slab of
+    distance_cost point into it. mapping_fd is the file, kept open so that copies of the problem map it too. */
+    void *mapping;
+    size_t mapping_size;
+    int mapping_fd;
 } problem;
 
+// | Number of costval between consecutive rows of n elements, so that each one starts on an aligned address
+static inline int problem_row_stride(int n){
+    int row_elems = PROBLEM_ROW_ALIGNMENT/sizeof(costval);
+    return ((n+row_elems-1)/row_elems)*row_elems;
+}
+
+// | Retrieves the row of assignment costs of the facility f to each client
+static inline costval *problem_assig_row(const problem *prob, int f){
+    return &prob->distance_cost[(long)f*prob->cli_stride]; // NOTE that f can be -1
+}
+// | Retrieves the costs of assigning the client c to each facility, NULL if the client-major copy isn't built
+static inline const costval *problem_client_row(const problem *prob, int c){
+    if(prob->distance_cost_t==NULL) return NULL;
+    return &prob->distance_cost_t[(long)c*prob->fac_stride]; // NOTE that the facility can be -1
+}
 // | Retrieves the cost of assigning the client c to the facility f
 static inline double problem_assig_cost(const problem *prob, int f, int c){
-    return prob->distance_cost[f][c]; // NOTE that f can be -1
+    return prob->distance_cost[(long)f*prob->cli_stride+c]; // NOTE that f can be -1
 }
 // | Retrieves the value (cost*-1) of assigning the client c to the facility f
 static inline double problem_assig_value(const problem *prob, int f, int c){
-    return -prob->distance_cost[f][c]; // NOTE that f can be -1
+    return -prob->distance_cost[(long)f*prob->cli_stride+c]; // NOTE that f can be -1
+}
+
+// | Retrieves the cost of assigning the client c to the facility f, from crow=problem_client_row(prob,c) when it isn't NULL
+static inline double problem_client_assig_cost(const problem *prob, const costval *crow, int f, int c){
+    return crow!=NULL? crow[f] : problem_assig_cost(prob,f,c);
+}
+// | Stores a cost on *dst, returns 0 if it lost precision
+static inline int problem_store_cost(costval *dst, double cost){
+    costval stored = (costval) cost;
+    *dst = stored;
+    return (double) stored == cost;
+}
+// | Stores the full precision cost of assigning the client c to the facility f, if the problem keeps them
+static inline void problem_set_exact_cost(problem *prob, int f, int c, double cost){
+    #ifdef PROBLEM_EXACT_COSTS
+        if(prob->exact_cost!=NULL) prob->exact_cost[(long)f*prob->n_clis+c] = cost;
+    #else
+        (void) prob; (void) f; (void) c; (void) cost;
+    #endif
+}
+// | Stores the cost of assigning the client c to the facility f, keeping track of precision losses
+static inline void problem_set_assig_cost(problem *prob, int f, int c, double cost){
+    if(!problem_store_cost(&prob->distance_cost[(long)f*prob->cli_stride+c],cost)) prob->lossless_costs = 0;
+    problem_set_exact_cost(prob,f,c,cost);
+}
+// | Retrieves the full precision cost of assigning the client c to the facility f, the stored one if they aren't kept
+static inline double problem_exact_assig_cost(const problem *prob, int f, int c){
+    if(prob->exact_cost==NULL || f<0) return problem_assig_cost(prob,f,c);
+    return prob->exact_cost[(long)f*prob->n_clis+c];
 }
 
 // Initializes a problem along with all the needed arrays.
 problem *problem_init(int n_facs, int n_clis);
 
+// Initializes a problem whose facility costs and cost matrix (starting on the row of facility -1) are read from
+// the file descriptor fd, mapped privately (so they are shared with other processes until written) at the given offsets,
+// that must be multiples of PROBLEM_ROW_ALIGNMENT. The problem owns fd and closes it when freed.
+problem *problem_init_mapped(int n_facs, int n_clis, int fd, size_t map_size, size_t facility_cost_offset, size_t distance_cost_offset);
+
+// Builds (or rebuilds) the client-major copy of the cost matrix, doubling its memory usage.
+void problem_init_client_major(problem *prob);
+
 // Initializes a problem copying data from another one.
 problem *problem_copy(const problem *other);
 
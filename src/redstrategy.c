@@ -129,6 +129,7 @@ redstrategy redstrategy_from_nomenclature(const char *nomenclature){
     }
 
     // Identify the dissimilitude and distance strategies
+    strategy.sketch_size = 0;
     if(n_scan<3){
         // Default dissimilitude:
         strategy.soldis = SOLDIS_PER_CLIENT_DELTA;
@@ -166,6 +167,20 @@ redstrategy redstrategy_from_nomenclature(const char *nomenclature){
             strategy.soldis = SOLDIS_INDEXES_VALUE;
             strategy.facdis = FACDIS_NONE;
         }
+        else if(strncmp(distm,"rpcd",4)==0){
+            strategy.soldis = SOLDIS_SKETCH_PER_CLIENT_DELTA;
+            strategy.facdis = FACDIS_NONE;
+            // The number of projections follows the abrev
+            strategy.sketch_size = SKETCH_DEFAULT_SIZE;
+            if(distm[4]!='\0'){
+                char *end;
+                strategy.sketch_size = strtol(&distm[4],&end,10);
+                if(*end!='\0' || strategy.sketch_size<1 || strategy.sketch_size>SKETCH_MAX_SIZE){
+                    fprintf(stderr,"ERROR: Invalid sketch size on \"%s\" (from 1 to %d)!\n",distm,SKETCH_MAX_SIZE);
+                    exit(1);
+                }
+            }
+        }
         else{
             fprintf(stderr,"ERROR: Invalid dissimilitude abrev \"%s\"!\n",distm);
             exit(1);
@@ -17,8 +17,13 @@ typedef enum {
     SOLDIS_PER_CLIENT_DELTA     = 2,  // D(A,B) = sum_j |v(A,j)-v(B,j)|
     SOLDIS_AUTO                 = 3,  // MGE w/SUM_OF_DELTAS or PCD
     SOLDIS_INDEXES_VALUE        = 4,  // Number of different indexes, solution value to break ties.
+    SOLDIS_SKETCH_PER_CLIENT_DELTA = 5,  // Estimation of PCD from random projections of the assignment costs.
 } soldismode;
 
+// Default and maximum number of random projections of the sketches used by SOLDIS_SKETCH_PER_CLIENT_DELTA.
+#define SKETCH_DEFAULT_SIZE 64
+#define SKETCH_MAX_SIZE 1024
+
 typedef enum {
     // | Pick the best solutions
     REDUCTION_BESTS,
@@ -41,6 +46,8 @@ typedef struct {
     soldismode soldis;
     facdismode facdis;
     int arg;
+    // Number of random projections for SOLDIS_SKETCH_PER_CLIENT_DELTA (0 for other dissimilitudes).
+    int sketch_size;
     // For some strategies, if it keeps the better solution so far:
     int elitist;
     // If this redstrategy will be used for path relinking (1) or on the construction process (0)
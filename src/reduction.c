@@ -1,9 +1,41 @@
 #include "reduction.h"
 
+typedef struct {
+    const rundata *run;
+    solution **sols;
+    int n_sols;
+    int *next_sol;
+} sketch_thread_args;
+
+void *sketch_thread_execution(void *arg){
+    sketch_thread_args *args = (sketch_thread_args *) arg;
+    int r;
+    while((r=threadpool_claim(args->next_sol))<args->n_sols){
+        if(!args->sols[r]->sketch_valid) solution_sketch_compute(args->run,args->sols[r]);
+    }
+    return NULL;
+}
+
+// Computes the sketches of the solutions that don't have them (the ones that weren't created by an expansion).
+void reduction_prepare_sketches(const rundata *run, solution **sols, int n_sols){
+    int next_sol = 0;
+    sketch_thread_args *targs = safe_malloc(sizeof(sketch_thread_args)*run->n_threads);
+    for(int i=0;i<run->n_threads;i++){
+        targs[i].run = run;
+        targs[i].sols = sols;
+        targs[i].n_sols = n_sols;
+        targs[i].next_sol = &next_sol;
+    }
+    threadpool_execute(run->pool,sketch_thread_execution,targs,sizeof(sketch_thread_args));
+    free(targs);
+}
+
 void reduce_by_redstrategy(const rundata *run, const redstrategy rstrat,
         solution **sols, int *n_sols){
     if(*n_sols<=rstrat.n_target) return;
 
+    if(rstrat.soldis==SOLDIS_SKETCH_PER_CLIENT_DELTA) reduction_prepare_sketches(run,sols,*n_sols);
+
     if(run->verbose) printf(
             "Reducing \033[31;1m%d\033[0m -> \033[31;1m%d\033[0m solutions, ",*n_sols,rstrat.n_target);
     if(rstrat.method==REDUCTION_BESTS){
@@ -1,5 +1,37 @@
 #include "reduction.h"
 
+/*
+When the dissimilitude is a metric (only pcd, the mge ones aren't: with min triangle distances D(a,a)>0),
+each solution keeps bounds of its dissimilitude to each centroid
+(exact when it was computed) as on Elkan's k-means, so the dissimilitude to a new centroid c_t isn't computed
+when for some old centroid c_k, D(c_k,c_t)-upper(r,k) or lower(r,k)-D(c_k,c_t) shows that
+it can't be smaller than the dissimilitude to the current nearest centroid.
+On dissimilitudes with many dimensions the bounds can be too loose to pay the cost of checking them,
+so after some rounds they are dropped if they didn't avoid enough dissimilitudes.
+*/
+
+// Maximum memory for the bounds, they are not used on larger reductions.
+#define SDBS_BOUNDS_MAX_BYTES (256LL*1024*1024)
+// Rounds before checking if the bounds pay off.
+#define SDBS_BOUNDS_WARMUP 8
+// The bounds are dropped when the avoided dissimilitudes (which cost about one operation per client)
+// are less than SDBS_BOUNDS_MIN_GAIN times the bounds that were checked or updated.
+#define SDBS_BOUNDS_MIN_GAIN 2
+
+// Closest float not smaller than v.
+static inline float float_up(double v){
+    float f = (float) v;
+    if((double)f<v) f = nextafterf(f,INFINITY);
+    return f;
+}
+
+// Closest float not larger than v.
+static inline float float_down(double v){
+    float f = (float) v;
+    if((double)f>v) f = nextafterf(f,-INFINITY);
+    return f;
+}
+
 typedef struct {
     int thread_id;
     int n_target;
@@ -13,18 +45,33 @@ typedef struct {
     solution **sols;
     soldismode soldis;
     facdismode facdis;
-    sem_t *thread_sem;   // The main thread picked the next centroid.
-    sem_t *complete_sem; // Inform that thread has terminated updating its part of nearest_cluster.
+    threadpool_barrier *barrier;
+    // | Farthest solution from the centroids found by each thread, and its distance.
+    int *candidates;
+    double *candidate_dists;
+    // | Bounds of the dissimilitude of each solution to each centroid (n_target per solution), NULL if unused.
+    float *upper_bounds;
+    float *lower_bounds;
+    // | Number of bounds checked or updated and dissimilitudes avoided only thanks to them by each thread.
+    long long int *thread_bound_ops;
+    long long int *thread_bound_saved;
+    // | Number of dissimilitudes computed and avoided to update the nearest centroids.
+    long long int n_evaluated;
+    long long int n_saved;
 } reductiondiv_thread_args;
 
 void *reductiondiv_thread_execution(void *arg){
     reductiondiv_thread_args *args = (reductiondiv_thread_args *) arg;
+    int n_threads = args->run->n_threads;
+    // All the threads pick the same centroids
+    int centroid = args->centroids[0];
+    int use_bounds = args->upper_bounds!=NULL;
+    long long int n_bound_ops = 0;
+    long long int n_bound_saved = 0;
     for(int t=0;t<args->n_target;t++){
-        sem_wait(args->thread_sem);
-        int centroid = args->centroids[t];
 
         // Help computing the distance of the new centroid to the old centroids
-        for(int k=args->thread_id;k<t;k+=args->run->n_threads){
+        for(int k=args->thread_id;k<t;k+=n_threads){
             int old_centroid = args->centroids[k];
             if(k==args->nearest_cluster[centroid]){
                 // Make use of already computed distance to the old centroid
@@ -35,11 +82,12 @@ void *reductiondiv_thread_execution(void *arg){
                 args->current2oldcentroid_dist[k] = disim;
             }
         }
-        sem_post(args->complete_sem);
-        sem_wait(args->thread_sem);
+        threadpool_barrier_wait(args->barrier);
 
-        // Help updating the dissimilitudes to each cluster
-        for(int r=args->thread_id;r<args->n_sols;r+=args->run->n_threads){
+        // Help updating the dissimilitudes to each cluster, finding the farthest solution from them
+        int farthest = -1;
+        double fardist = -INFINITY;
+        for(int r=args->thread_id;r<args->n_sols;r+=n_threads){
             /* It is not necessary to compute the dissimilitude between the
             new centroid and solution r if the distance between r and its old
             centroid is smaller than half the distance between the new centroid
@@ -49,17 +97,90 @@ void *reductiondiv_thread_execution(void *arg){
 
             // The cluster where r currently is
             int r_cluster = args->nearest_cluster[r];
+            double near_dist = args->nearest_dist[r];
 
-            if(t==0 || args->nearest_dist[r]>0.5*args->current2oldcentroid_dist[r_cluster]){
+            int compute = t==0 || near_dist>0.5*args->current2oldcentroid_dist[r_cluster];
+            float *upper = NULL;
+            float *lower = NULL;
+            if(use_bounds){
+                upper = &args->upper_bounds[(long long int)r*args->n_target];
+                lower = &args->lower_bounds[(long long int)r*args->n_target];
+                n_bound_ops += 1;
+                // Check the bounds with the other old centroids
+                for(int k=0;k<t && compute;k++){
+                    n_bound_ops += 1;
+                    double cdist = args->current2oldcentroid_dist[k];
+                    if(cdist-upper[k]>=near_dist || lower[k]-cdist>=near_dist){
+                        compute = 0;
+                        n_bound_saved += 1;
+                    }
+                }
+            }
+            if(compute){
                 double disim = solution_dissimilitude(args->run,
                     args->sols[r],args->sols[centroid],args->soldis,args->facdis);
-                if(disim<args->nearest_dist[r]){
+                args->n_evaluated += 1;
+                if(upper!=NULL){
+                    upper[t] = float_up(disim);
+                    lower[t] = float_down(disim);
+                }
+                if(disim<near_dist){
                     args->nearest_cluster[r] = t;
                     args->nearest_dist[r] = disim;
                 }
+            }else{
+                args->n_saved += 1;
+                if(upper!=NULL){
+                    // Triangle inequality through the nearest centroid
+                    double cdist = args->current2oldcentroid_dist[r_cluster];
+                    upper[t] = float_up(cdist+near_dist);
+                    lower[t] = float_down(cdist-near_dist>near_dist? cdist-near_dist : near_dist);
+                }
+            }
+            if(args->nearest_dist[r]>fardist){
+                farthest = r;
+                fardist = args->nearest_dist[r];
+            }
+        }
+        args->candidates[args->thread_id] = farthest;
+        args->candidate_dists[args->thread_id] = fardist;
+        args->thread_bound_ops[args->thread_id] = n_bound_ops;
+        args->thread_bound_saved[args->thread_id] = n_bound_saved;
+
+        if(t==args->n_target-1) break;
+        threadpool_barrier_wait(args->barrier);
+
+        // Find the new centroid, the farthest candidate (the first one on ties)
+        farthest = -1;
+        fardist = -INFINITY;
+        for(int i=0;i<n_threads;i++){
+            int cand = args->candidates[i];
+            if(cand==-1) continue;
+            if(args->candidate_dists[i]>fardist || (args->candidate_dists[i]==fardist && cand<farthest)){
+                farthest = cand;
+                fardist = args->candidate_dists[i];
+            }
+        }
+        assert(farthest!=-1);
+
+        // Drop the bounds if they don't pay off, all the threads take the same decision
+        if(use_bounds && t>=SDBS_BOUNDS_WARMUP){
+            long long int total_ops = 0;
+            long long int total_saved = 0;
+            for(int i=0;i<n_threads;i++){
+                total_ops += args->thread_bound_ops[i];
+                total_saved += args->thread_bound_saved[i];
             }
+            if(total_saved*args->run->prob->n_clis<SDBS_BOUNDS_MIN_GAIN*total_ops) use_bounds = 0;
+        }
+
+        // Add the new centroid, is_centroid is only used by the thread that updates the solution
+        if(farthest%n_threads==args->thread_id){
+            assert(!args->is_centroid[farthest]);
+            args->is_centroid[farthest] = 1;
         }
-        sem_post(args->complete_sem);
+        if(args->thread_id==0) args->centroids[t+1] = farthest;
+        centroid = farthest;
     }
     return NULL;
 }
@@ -74,7 +195,7 @@ void reduction_diversity_starting(const rundata *run, solution **sols, int *n_so
     int *is_centroid = safe_malloc(sizeof(int)*(*n_sols));
     // Pick solution 0 as first centroid
     centroids[0] = 0;
-    int n_centroids = 1;
+    int n_centroids = n_target;
     // Nearest cluster index and distance to it
     int *nearest_cluster = safe_malloc(sizeof(int)*(*n_sols));
     double *nearest_dist = safe_malloc(sizeof(double)*(*n_sols));
@@ -87,16 +208,25 @@ void reduction_diversity_starting(const rundata *run, solution **sols, int *n_so
         is_centroid[i] = 0;
     }
     is_centroid[0] = 1;
-    // Create threads
-    pthread_t *threads = safe_malloc(sizeof(pthread_t)*run->n_threads);
-    sem_t **t_sems = safe_malloc(sizeof(sem_t *)*run->n_threads);
-    sem_t **c_sems = safe_malloc(sizeof(sem_t *)*run->n_threads);
+    // Farthest solution found by each thread
+    int *candidates = safe_malloc(sizeof(int)*run->n_threads);
+    double *candidate_dists = safe_malloc(sizeof(double)*run->n_threads);
+    long long int *thread_bound_ops = safe_malloc(sizeof(long long int)*run->n_threads);
+    long long int *thread_bound_saved = safe_malloc(sizeof(long long int)*run->n_threads);
+    // Bounds of the dissimilitudes to the centroids, for metrics
+    float *upper_bounds = NULL;
+    float *lower_bounds = NULL;
+    int metric = soldis==SOLDIS_PER_CLIENT_DELTA;
+    long long int bounds_size = (long long int)(*n_sols)*n_target;
+    if(metric && 2*bounds_size*(long long int)sizeof(float)<=SDBS_BOUNDS_MAX_BYTES){
+        upper_bounds = safe_malloc(sizeof(float)*bounds_size);
+        lower_bounds = safe_malloc(sizeof(float)*bounds_size);
+    }
+    // The threads select the centroids synchronizing on a barrier
+    threadpool_barrier barrier;
+    threadpool_barrier_init(&barrier,run->n_threads);
     reductiondiv_thread_args *targs = safe_malloc(sizeof(reductiondiv_thread_args)*run->n_threads);
     for(int i=0;i<run->n_threads;i++){
-        // Init semaphores
-        t_sems[i] = dc_semaphore_init();
-        c_sems[i] = dc_semaphore_init();
-
         // Thread args
         targs[i].thread_id = i;
         targs[i].n_target = n_target;
@@ -110,61 +240,29 @@ void reduction_diversity_starting(const rundata *run, solution **sols, int *n_so
         targs[i].sols = sols;
         targs[i].soldis = soldis;
         targs[i].facdis = facdis;
-        targs[i].thread_sem = t_sems[i];
-        targs[i].complete_sem = c_sems[i];
-        int rc = pthread_create(&threads[i],NULL,reductiondiv_thread_execution,&targs[i]);
-        if(rc){
-            fprintf(stderr,"ERROR: Error %d on pthread_create\n",rc);
-            exit(1);
-        }
+        targs[i].barrier = &barrier;
+        targs[i].candidates = candidates;
+        targs[i].candidate_dists = candidate_dists;
+        targs[i].upper_bounds = upper_bounds;
+        targs[i].lower_bounds = lower_bounds;
+        targs[i].thread_bound_ops = thread_bound_ops;
+        targs[i].thread_bound_saved = thread_bound_saved;
+        targs[i].n_evaluated = 0;
+        targs[i].n_saved = 0;
     }
-    for(int t=0;t<n_target;t++){
-
-        // Allow threads to compute current2oldcentroid_dist
-        for(int i=0;i<run->n_threads;i++) sem_post(t_sems[i]);
-        // Wait for all threads to finish
-        for(int i=0;i<run->n_threads;i++) sem_wait(c_sems[i]);
-
-        // Allow threads to update the centroids of each solution
-        for(int i=0;i<run->n_threads;i++) sem_post(t_sems[i]);
-        // Wait for all threads to finish
-        for(int i=0;i<run->n_threads;i++) sem_wait(c_sems[i]);
-
-        if(t==n_target-1) break;
-
-        // Find the new centroid
-        int farthest = -1;
-        double fardist = -INFINITY;
-        for(int i=1;i<*n_sols;i++){
-            if(!is_centroid[i] && nearest_dist[i] > fardist){
-                farthest = i;
-                fardist = nearest_dist[farthest];
-            }
-        }
-        assert(farthest!=-1);
-
-        // Add the new centroid
-        centroids[n_centroids] = farthest;
-        assert(!is_centroid[farthest]);
-        is_centroid[farthest] = 1;
-        n_centroids += 1;
-    }
-    assert(n_centroids==n_target);
-
-    // Join threads
+    threadpool_execute(run->pool,reductiondiv_thread_execution,targs,sizeof(reductiondiv_thread_args));
     for(int i=0;i<run->n_threads;i++){
-        pthread_join(threads[i],NULL);
+        run->run_inf->n_sdbs_dissimilitudes       += targs[i].n_evaluated;
+        run->run_inf->n_sdbs_dissimilitudes_saved += targs[i].n_saved;
     }
-    free(threads);
     free(targs);
-
-    // Destroy semaphores
-    for(int i=0;i<run->n_threads;i++){
-        dc_semaphore_free(c_sems[i]);
-        dc_semaphore_free(t_sems[i]);
-    }
-    free(c_sems);
-    free(t_sems);
+    free(lower_bounds);
+    free(upper_bounds);
+    threadpool_barrier_destroy(&barrier);
+    free(thread_bound_saved);
+    free(thread_bound_ops);
+    free(candidate_dists);
+    free(candidates);
 
     /* Select final solutions */
     // Ensure that the centroid is part of its cluster (in case of distance 0 ties)
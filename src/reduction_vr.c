@@ -9,27 +9,29 @@ typedef struct {
 } dissimpair;
 
 
-// Compare dissimpairs by dissimilitude (<0 means a has less dissimilitude)
+// Compare dissimpairs by dissimilitude (<0 means a has less dissimilitude), then by ids
 int dissimpair_cmp(dissimpair a, dissimpair b){
-    double delta = a.dissim - b.dissim;
-    if(delta!=0) return delta;
-    delta = a.id1-b.id1;
-    if(delta!=0) return delta;
-    delta = a.id2-b.id2;
-    return (delta==0)? 0 : ((delta<0)? -1 : +1);
+    if(a.dissim!=b.dissim) return (a.dissim<b.dissim)? -1 : +1;
+    if(a.id1!=b.id1) return (a.id1<b.id1)? -1 : +1;
+    if(a.id2!=b.id2) return (a.id2<b.id2)? -1 : +1;
+    return 0;
 }
 
-// A heap of dissimpairs
+// A heap of dissimpairs.
+// Pairs of discarded solutions are only removed when the heap is full, before growing it,
+// so its memory stays proportional to the pairs that are still valid.
 typedef struct {
     dissimpair *elems;
     lint len;
     lint size;
 } pairheap;
 
+#define PAIRHEAP_MIN_SIZE 64
+
 // Initializes a heap of dissimpairs.
 pairheap *pairheap_init(lint size){
     pairheap *heap = safe_malloc(sizeof(pairheap));
-    heap->size = size;
+    heap->size = size>PAIRHEAP_MIN_SIZE? size : PAIRHEAP_MIN_SIZE;
     heap->len = 0;
     heap->elems = safe_malloc(sizeof(dissimpair)*heap->size);
     return heap;
@@ -41,14 +43,8 @@ void pairheap_free(pairheap *heap){
     free(heap);
 }
 
-// Gets the dissimpair of smaller dissimilitude of the heap, removing it.
-dissimpair pairheap_poll(pairheap *heap){
-    assert(heap->len>0);
-    dissimpair ret = heap->elems[0];
-    heap->elems[0] = heap->elems[heap->len-1];
-    heap->len -= 1;
-    // Heapify down:
-    lint i = 0;
+// Moves down the element at position i until its children are larger.
+static void pairheap_sift_down(pairheap *heap, lint i){
     lint c = 2*i+1;
     while(c<heap->len){
         if(c+1<heap->len && dissimpair_cmp(heap->elems[c+1],heap->elems[c])<0) c = c+1;
@@ -59,12 +55,46 @@ dissimpair pairheap_poll(pairheap *heap){
         i = c;
         c = 2*i+1;
     }
+}
+
+// Removes the pairs with a discarded solution (discarded[id]==1) from the heap.
+void pairheap_compact(pairheap *heap, const int *discarded){
+    lint n_valid = 0;
+    for(lint i=0;i<heap->len;i++){
+        dissimpair pair = heap->elems[i];
+        if(discarded[pair.id1]==1 || discarded[pair.id2]==1) continue;
+        heap->elems[n_valid++] = pair;
+    }
+    heap->len = n_valid;
+    // Rebuild the heap
+    for(lint i=heap->len/2-1;i>=0;i--) pairheap_sift_down(heap,i);
+}
+
+// Gets the dissimpair of smaller dissimilitude of the heap, removing it.
+dissimpair pairheap_poll(pairheap *heap){
+    assert(heap->len>0);
+    dissimpair ret = heap->elems[0];
+    heap->elems[0] = heap->elems[heap->len-1];
+    heap->len -= 1;
+    pairheap_sift_down(heap,0);
+    // Release memory when most of it is unused
+    if(heap->size>PAIRHEAP_MIN_SIZE && heap->len<heap->size/4){
+        heap->size /= 2;
+        heap->elems = safe_realloc(heap->elems,sizeof(dissimpair)*heap->size);
+    }
     return ret;
 }
 
-// Adds a dissimpair to the heap.
-void pairheap_add(pairheap *heap, dissimpair val){
-    assert(heap->len<heap->size);
+// Adds a dissimpair to the heap. When it is full, the pairs of discarded solutions are removed
+// and it only grows (by a quarter) if less than an eighth of it was freed.
+void pairheap_add(pairheap *heap, dissimpair val, const int *discarded){
+    if(heap->len==heap->size){
+        pairheap_compact(heap,discarded);
+        if(heap->len>heap->size-heap->size/8){
+            heap->size += heap->size/4;
+            heap->elems = safe_realloc(heap->elems,sizeof(dissimpair)*heap->size);
+        }
+    }
     heap->len += 1;
     heap->elems[heap->len-1] = val;
     // Heapify up:
@@ -79,103 +109,134 @@ void pairheap_add(pairheap *heap, dissimpair val){
     }
 }
 
+// Index of the heap with the smallest dissimpair on top, -1 if all of them are empty.
+int pairheaps_min(pairheap **heaps, int n_heaps){
+    int best = -1;
+    for(int i=0;i<n_heaps;i++){
+        if(heaps[i]->len==0) continue;
+        if(best==-1 || dissimpair_cmp(heaps[i]->elems[0],heaps[best]->elems[0])<0) best = i;
+    }
+    return best;
+}
+
+/*
+The solutions are eliminated in the same order as eliminating them one at a time: poll the most similar pair,
+delete its worst solution if both are still there, and add the pairs between the vision_range solutions before
+and after it that are now within vision range.
+Each round picks a batch of candidate eliminations (the next valid pairs of the heaps) whose vision windows
+don't contain the other candidates, so their new pairs don't depend on the other eliminations and
+can be computed in parallel. A candidate is only accepted if the new pairs of the previous candidates of
+the batch are all less similar than it, otherwise it and the next ones are rolled back to the heaps.
+The batches only have the candidates required to give VR_PAIRS_PER_THREAD new pairs to each thread.
+The new pairs of the rolled back candidates are kept for the next round, as most of them are candidates
+again with the same vision windows.
+Each thread owns a heap, where it adds the pairs it computes, and the smallest pair is taken from their tops.
+*/
+
+#define VR_PAIRS_PER_THREAD 8
+
 typedef struct {
     // Parameters
     int thread_id;
     int vision_range;
     soldismode soldis;
     facdismode facdis;
-    // Concurrent axes to heap
-    pthread_mutex_t *heap_mutex;
+    // Heap of the thread
     pairheap *heap;
     // Solutions (read only)
     const rundata *run;
     int n_sols;
     const solution **sols;
-    // Fast way of getting previous and next solutions
-    const int *prev_sols;
-    const int *next_sols;
-    // Semaphores
-    sem_t *thread_sem;   // The main thread finished.
-    sem_t *complete_sem; // Inform that thread has finished.
-    int *terminated;     // For the main thread to inform that the job is done.
+    // Discarded solutions (read only), to remove their pairs from the heap
+    const int *discarted;
+    // Current batch: pair polled for each candidate, and solutions before and after them
+    int n_cands;
+    const dissimpair *cand_pairs;
+    const int *cand_prevs;
+    const int *cand_nexts;
+    // Pairs polled since the first candidate, rolled back if their candidate is
+    const dissimpair *polled;
+    const int *cand_polled_pos;
+    int n_polled;
+    // New pairs of each candidate (id1 is -1 when there isn't a pair)
+    dissimpair *new_pairs;
+    // If the new pairs of each candidate were already computed
+    const int *cand_reused;
+    // Threads synchronize to check the batch once all its pairs are computed
+    threadpool_barrier *barrier;
+    // Number of accepted candidates, set by thread 0
+    int *n_accepted;
 } reductionvr_thread_args;
 
-void *reductionvr_thread_execution(void *arg){
+void *reductionvr_build_thread_execution(void *arg){
     reductionvr_thread_args *args = (reductionvr_thread_args *) arg;
-
-    { // Help building initial set of dissimilitude pairs
-        dissimpair *pairs = safe_malloc(sizeof(dissimpair)*args->vision_range);
-        int n_pairs = 0;
-        for(int i=args->thread_id;i<args->n_sols;i+=args->run->n_threads){
-            for(int j=1;j<=args->vision_range;j++){
-                if(i+j>=args->n_sols) break;
-                pairs[n_pairs].id1 = i;
-                pairs[n_pairs].id2 = i+j;
-                pairs[n_pairs].dissim = solution_dissimilitude(
-                    args->run,args->sols[i],args->sols[i+j],
-                    args->soldis,args->facdis);
-                n_pairs += 1;
-            }
-            // Add pairs to the heap
-            pthread_mutex_lock(args->heap_mutex);
-                for(int k=0;k<n_pairs;k++) pairheap_add(args->heap,pairs[k]);
-            pthread_mutex_unlock(args->heap_mutex);
-            // Delete pairs
-            n_pairs = 0;
+    // Build the initial set of dissimilitude pairs on the heap of the thread
+    for(int i=args->thread_id;i<args->n_sols;i+=args->run->n_threads){
+        for(int j=1;j<=args->vision_range;j++){
+            if(i+j>=args->n_sols) break;
+            dissimpair pair;
+            pair.id1 = i;
+            pair.id2 = i+j;
+            pair.dissim = solution_dissimilitude(
+                args->run,args->sols[i],args->sols[i+j],
+                args->soldis,args->facdis);
+            pairheap_add(args->heap,pair,args->discarted);
         }
-        free(pairs);
     }
+    return NULL;
+}
 
-    { // Wake when required to compute new dissimilitudes
-        dissimpair *pair_buffer = safe_malloc(sizeof(dissimpair)
-            *(1+args->vision_range/args->run->n_threads));
-        int pair_buffer_len = 0;
-        // Each time a solution is deleted
-        while(1){
-            sem_post(args->complete_sem);
-            // ---@> Main thread works here.
-            sem_wait(args->thread_sem);
-            assert(args->prev_sols!=NULL);
-            assert(args->next_sols!=NULL);
-            // If main thread says the job is done, break
-            if(*args->terminated) break;
-            // Create new pairs
-            for(int i=args->thread_id;i<args->vision_range;i+=args->run->n_threads){
-                int pair_a = args->prev_sols[args->vision_range-1-i];
-                int pair_b = args->next_sols[i];
-                if(pair_a!=-1 && pair_b!=-1){
-                    // Create the replace dissimpair:
-                    dissimpair pair;
-                    pair.id1 = pair_a;
-                    pair.id2 = pair_b;
-                    pair.dissim = solution_dissimilitude(args->run,
-                        args->sols[pair_a],args->sols[pair_b],
-                        args->soldis,args->facdis);
-                    // Add to pair buffer:
-                    pair_buffer[pair_buffer_len] = pair;
-                    pair_buffer_len += 1;
-                    // Add pairs in buffer to to the heap if mutex is free
-                    if(pthread_mutex_trylock(args->heap_mutex)==0){
-                        for(int k=0;k<pair_buffer_len;k++){
-                            pairheap_add(args->heap,pair_buffer[k]);
-                        }
-                        pthread_mutex_unlock(args->heap_mutex);
-                        pair_buffer_len = 0;
-                    }
-                }
-            }
-            // If pairs remain, wait for mutex
-            if(pair_buffer_len>0){
-                pthread_mutex_lock(args->heap_mutex);
-                for(int i=0;i<pair_buffer_len;i++){
-                    pairheap_add(args->heap,pair_buffer[i]);
-                }
-                pthread_mutex_unlock(args->heap_mutex);
-                pair_buffer_len = 0;
+void *reductionvr_batch_thread_execution(void *arg){
+    reductionvr_thread_args *args = (reductionvr_thread_args *) arg;
+    int vr = args->vision_range;
+    int n_items = args->n_cands*vr;
+    // Compute the new pairs of the candidates
+    for(int k=args->thread_id;k<n_items;k+=args->run->n_threads){
+        int c = k/vr;
+        int i = k%vr;
+        if(args->cand_reused[c]) continue;
+        int pair_a = args->cand_prevs[c*vr+vr-1-i];
+        int pair_b = args->cand_nexts[c*vr+i];
+        dissimpair pair;
+        pair.id1 = -1;
+        pair.id2 = -1;
+        pair.dissim = INFINITY;
+        if(pair_a!=-1 && pair_b!=-1){
+            pair.id1 = pair_a;
+            pair.id2 = pair_b;
+            pair.dissim = solution_dissimilitude(args->run,
+                args->sols[pair_a],args->sols[pair_b],
+                args->soldis,args->facdis);
+        }
+        args->new_pairs[k] = pair;
+    }
+    threadpool_barrier_wait(args->barrier);
+    // Accept the candidates while the new pairs of the previous ones are less similar (all threads get the same result)
+    int n_accepted = 1;
+    int have_min = 0;
+    dissimpair min_new;
+    while(n_accepted<args->n_cands){
+        for(int i=0;i<vr;i++){
+            dissimpair pair = args->new_pairs[(n_accepted-1)*vr+i];
+            if(pair.id1==-1) continue;
+            if(!have_min || dissimpair_cmp(pair,min_new)<0){
+                min_new = pair;
+                have_min = 1;
             }
         }
-        free(pair_buffer);
+        if(have_min && dissimpair_cmp(min_new,args->cand_pairs[n_accepted])<0) break;
+        n_accepted += 1;
+    }
+    if(args->thread_id==0) *args->n_accepted = n_accepted;
+    // Add the new pairs of the accepted candidates to the heap of the thread
+    for(int k=args->thread_id;k<n_accepted*vr;k+=args->run->n_threads){
+        if(args->new_pairs[k].id1!=-1) pairheap_add(args->heap,args->new_pairs[k],args->discarted);
+    }
+    // Return the pairs polled from the first rejected candidate
+    if(n_accepted<args->n_cands){
+        for(int k=args->cand_polled_pos[n_accepted]+args->thread_id;k<args->n_polled;k+=args->run->n_threads){
+            pairheap_add(args->heap,args->polled[k],args->discarted);
+        }
     }
     return NULL;
 }
@@ -190,151 +251,214 @@ void reduction_vr_heuristic(const rundata *run, solution **sols, int *n_sols,
     qsort(sols,*n_sols,sizeof(solution *),solutionp_value_cmp_inv);
     // Return if there is no need of reduction.
     if(*n_sols<=n_target) return;
-    // To know if a solution has been discarded:
+    // Reduce the vision range if its pairs don't fit on the memory limit,
+    // leaving room for the pairs of discarded solutions that the heaps keep until they are full.
+    if(run->vr_heap_limit_mb>0){
+        lint max_pairs = ((lint)run->vr_heap_limit_mb*1024*1024*2/3)/sizeof(dissimpair);
+        lint max_vision_range = max_pairs/(*n_sols);
+        if(max_vision_range<1) max_vision_range = 1;
+        if(vision_range>max_vision_range){
+            if(run->verbose) fprintf(stderr,"WARNING: vrh vision range reduced from %d to %d to fit in %d MB.\n",
+                vision_range,(int)max_vision_range,run->vr_heap_limit_mb);
+            vision_range = (int)max_vision_range;
+        }
+    }
+    int vr = vision_range;
+    // To know if a solution has been discarded (2 for candidates of the current batch):
     int *discarted = safe_malloc((*n_sols)*sizeof(int));
     for(int i=0;i<*n_sols;i++) discarted[i] = 0;
 
-    // The solutions previous and next to the last deleted solution
-    // (to communicate with the threads).
-    int *prev_sols = safe_malloc(sizeof(int)*vision_range);
-    int *next_sols = safe_malloc(sizeof(int)*vision_range);
+    // Double linked list to know which solution comes before and after it
+    int *nexts = safe_malloc((*n_sols)*sizeof(int));
+    int *prevs = safe_malloc((*n_sols)*sizeof(int));
+    for(int i=0;i<*n_sols;i++){
+        prevs[i] = i-1;
+        nexts[i] = i+1;
+    }
+    prevs[0] = -1;
+    nexts[*n_sols-1] = -1;
+
+    // Heaps of dissimilitude pairs, one for each thread
+    pairheap **heaps = safe_malloc(sizeof(pairheap *)*run->n_threads);
+    for(int i=0;i<run->n_threads;i++){
+        heaps[i] = pairheap_init(((lint)(*n_sols)*vr)/run->n_threads+vr);
+    }
 
-    // Heap of dissimilitude pairs
-    pairheap *heap = pairheap_init(2*(*n_sols)*vision_range);
-    pthread_mutex_t heap_mutex;
-    pthread_mutex_init(&heap_mutex,NULL);
+    // Batch data
+    int max_cands = (VR_PAIRS_PER_THREAD*run->n_threads)/vr;
+    if(max_cands<1) max_cands = 1;
+    dissimpair *cand_pairs = safe_malloc(sizeof(dissimpair)*max_cands);
+    int *cand_prevs = safe_malloc(sizeof(int)*max_cands*vr);
+    int *cand_nexts = safe_malloc(sizeof(int)*max_cands*vr);
+    int *cand_polled_pos = safe_malloc(sizeof(int)*max_cands);
+    dissimpair *new_pairs = safe_malloc(sizeof(dissimpair)*max_cands*vr);
+    int *cand_reused = safe_malloc(sizeof(int)*max_cands);
+    // Candidates rolled back on the last round, and their vision windows and new pairs
+    int n_rolled = 0;
+    int *rolled = safe_malloc(sizeof(int)*max_cands);
+    int *rolled_prevs = safe_malloc(sizeof(int)*max_cands*vr);
+    int *rolled_nexts = safe_malloc(sizeof(int)*max_cands*vr);
+    dissimpair *rolled_pairs = safe_malloc(sizeof(dissimpair)*max_cands*vr);
+    int polled_size = max_cands;
+    dissimpair *polled = safe_malloc(sizeof(dissimpair)*polled_size);
+    int n_accepted = 0;
+    threadpool_barrier barrier;
+    threadpool_barrier_init(&barrier,run->n_threads);
 
-    // Create threads:
-    pthread_t *threads = safe_malloc(sizeof(pthread_t)*run->n_threads);
-    sem_t **t_sems = safe_malloc(sizeof(sem_t *)*run->n_threads);
-    sem_t **c_sems = safe_malloc(sizeof(sem_t *)*run->n_threads);
     reductionvr_thread_args *targs = safe_malloc(sizeof(reductionvr_thread_args)*run->n_threads);
-    int terminated = 0; // NOTE: Only access before threads are waken.
-    //
     for(int i=0;i<run->n_threads;i++){
-        // Init semaphores
-        t_sems[i] = dc_semaphore_init();
-        c_sems[i] = dc_semaphore_init();
-
         // Parameters
         targs[i].thread_id = i;
-        targs[i].vision_range = vision_range;
+        targs[i].vision_range = vr;
         targs[i].soldis = soldis;
         targs[i].facdis = facdis;
-        // Concurrent axes to heap
-        targs[i].heap_mutex = &heap_mutex;
-        targs[i].heap = heap;
+        targs[i].heap = heaps[i];
         // Solutions (read only)
         targs[i].run = run;
         targs[i].n_sols = *n_sols;
         targs[i].sols = (const solution **) sols;
-        // Fast way of getting previous and next solutions
-        targs[i].prev_sols = prev_sols;
-        targs[i].next_sols = next_sols;
-        // Semaphores
-        targs[i].thread_sem = t_sems[i];
-        targs[i].complete_sem = c_sems[i];
-        targs[i].terminated = &terminated;
-
-        // Initialize thread
-        int rc = pthread_create(&threads[i],NULL,reductionvr_thread_execution,&targs[i]);
-        if(rc){
-            fprintf(stderr,"Error %d on thread creation\n",rc);
-            exit(1);
-        }
+        targs[i].discarted = discarted;
+        // Batch
+        targs[i].n_cands = 0;
+        targs[i].cand_pairs = cand_pairs;
+        targs[i].cand_prevs = cand_prevs;
+        targs[i].cand_nexts = cand_nexts;
+        targs[i].cand_polled_pos = cand_polled_pos;
+        targs[i].new_pairs = new_pairs;
+        targs[i].cand_reused = cand_reused;
+        targs[i].barrier = &barrier;
+        targs[i].n_accepted = &n_accepted;
     }
-
-    // Double linked list to know which solution comes before and after it
-    int *nexts = safe_malloc((*n_sols)*sizeof(int));
-    int *prevs = safe_malloc((*n_sols)*sizeof(int));
-    for(int i=0;i<*n_sols;i++){
-        prevs[i] = i-1;
-        nexts[i] = i+1;
-    }
-    prevs[0] = -1;
-    nexts[*n_sols-1] = -1;
-
-    // Wait for all threads to terminate the last job
-    for(int i=0;i<run->n_threads;i++){
-        sem_wait(c_sems[i]);
-    }
-    // ---@> At this point, all initial dissimilitude pairs are complete.
+    // Compute the initial dissimilitude pairs
+    threadpool_execute(run->pool,reductionvr_build_thread_execution,targs,sizeof(reductionvr_thread_args));
 
     // Eliminate as many solutions as required:
     int n_eliminate = *n_sols-n_target;
     int elims = 0;
     while(elims<n_eliminate){
-        // Eliminate worst solution of most similar pair
-        if(heap->len==0) break;
-        dissimpair pair = pairheap_poll(heap);
-        if(!discarted[pair.id1] && !discarted[pair.id2]){
-            // Delete the second solution on the pair.
+        // Pick the candidates
+        int n_cands = 0;
+        int n_polled = 0;
+        while(elims+n_cands<n_eliminate && n_cands<max_cands){
+            int h = pairheaps_min(heaps,run->n_threads);
+            if(h==-1) break;
+            dissimpair pair = pairheap_poll(heaps[h]);
+            if(discarted[pair.id1] || discarted[pair.id2]){
+                // Keep it in case that the candidate that discarded it is rolled back
+                if(n_cands>0){
+                    if(n_polled==polled_size){
+                        polled_size *= 2;
+                        polled = safe_realloc(polled,sizeof(dissimpair)*polled_size);
+                    }
+                    polled[n_polled++] = pair;
+                }
+                continue;
+            }
+            // The worst solution on the pair would be deleted
             int to_delete = pair.id2;
-            discarted[to_delete] = 1;
-            solution_free(sols[to_delete]);
-            elims += 1;
-            // Update double linked list:
-            if(nexts[to_delete]!=-1) prevs[nexts[to_delete]] = prevs[to_delete];
-            if(prevs[to_delete]!=-1) nexts[prevs[to_delete]] = nexts[to_delete];
-            // Add new pairs to replace those that will be deleted on the destroyed solution.
-            int iter;
+            int *cprevs = &cand_prevs[n_cands*vr];
+            int *cnexts = &cand_nexts[n_cands*vr];
+            int conflict = 0;
             // Get solutions after
-            iter = to_delete;
-            for(int i=0;i<vision_range;i++){
+            int iter = to_delete;
+            for(int i=0;i<vr;i++){
                 if(nexts[iter]==-1){
-                    next_sols[i] = -1;
+                    cnexts[i] = -1;
                 }else{
                     iter = nexts[iter];
-                    next_sols[i] = iter;
+                    cnexts[i] = iter;
+                    if(discarted[iter]) conflict = 1;
                 }
             }
             // Get solutions before
             iter = to_delete;
-            for(int i=0;i<vision_range;i++){
+            for(int i=0;i<vr;i++){
                 if(prevs[iter]==-1){
-                    prev_sols[i] = -1;
+                    cprevs[i] = -1;
                 }else{
                     iter = prevs[iter];
-                    prev_sols[i] = iter;
+                    cprevs[i] = iter;
+                    if(discarted[iter]) conflict = 1;
                 }
             }
-            // Wake threads to create new pairs
-            for(int i=0;i<run->n_threads;i++){
-                sem_post(t_sems[i]);
+            if(conflict){
+                // Its new pairs depend on another candidate, leave it for the next round
+                pairheap_add(heaps[h],pair,discarted);
+                break;
+            }
+            // Add the candidate
+            if(n_polled==polled_size){
+                polled_size *= 2;
+                polled = safe_realloc(polled,sizeof(dissimpair)*polled_size);
             }
-            // Wait for all threads to terminate their job
-            for(int i=0;i<run->n_threads;i++){
-                sem_wait(c_sems[i]);
+            cand_polled_pos[n_cands] = n_polled;
+            polled[n_polled++] = pair;
+            cand_pairs[n_cands] = pair;
+            discarted[to_delete] = 2;
+            // Reuse its new pairs if it was rolled back on the last round with the same vision windows
+            cand_reused[n_cands] = 0;
+            for(int r=0;r<n_rolled;r++){
+                if(rolled[r]==to_delete
+                        && memcmp(&rolled_prevs[r*vr],cprevs,sizeof(int)*vr)==0
+                        && memcmp(&rolled_nexts[r*vr],cnexts,sizeof(int)*vr)==0){
+                    memcpy(&new_pairs[n_cands*vr],&rolled_pairs[r*vr],sizeof(dissimpair)*vr);
+                    cand_reused[n_cands] = 1;
+                    break;
+                }
             }
+            n_cands += 1;
         }
-    }
-
-    // Wake threads for termination
-    terminated = 1;
-    for(int i=0;i<run->n_threads;i++){
-        sem_post(t_sems[i]);
-    }
+        if(n_cands==0) break;
 
-    // Join threads
-    for(int i=0;i<run->n_threads;i++){
-        pthread_join(threads[i],NULL);
-    }
-    free(threads);
-    free(targs);
+        // Compute their new pairs and check them
+        for(int i=0;i<run->n_threads;i++){
+            targs[i].n_cands = n_cands;
+            targs[i].polled = polled;
+            targs[i].n_polled = n_polled;
+        }
+        threadpool_execute(run->pool,reductionvr_batch_thread_execution,targs,sizeof(reductionvr_thread_args));
+        assert(n_accepted>=1 && n_accepted<=n_cands);
 
-    // Destroy semaphores
-    for(int i=0;i<run->n_threads;i++){
-        dc_semaphore_free(t_sems[i]);
-        dc_semaphore_free(c_sems[i]);
+        // Delete the accepted candidates
+        n_rolled = 0;
+        for(int c=0;c<n_cands;c++){
+            int to_delete = cand_pairs[c].id2;
+            if(c>=n_accepted){
+                discarted[to_delete] = 0;
+                // Keep its new pairs
+                rolled[n_rolled] = to_delete;
+                memcpy(&rolled_prevs[n_rolled*vr],&cand_prevs[c*vr],sizeof(int)*vr);
+                memcpy(&rolled_nexts[n_rolled*vr],&cand_nexts[c*vr],sizeof(int)*vr);
+                memcpy(&rolled_pairs[n_rolled*vr],&new_pairs[c*vr],sizeof(dissimpair)*vr);
+                n_rolled += 1;
+                continue;
+            }
+            discarted[to_delete] = 1;
+            solution_free(sols[to_delete]);
+            elims += 1;
+            // Update double linked list:
+            if(nexts[to_delete]!=-1) prevs[nexts[to_delete]] = prevs[to_delete];
+            if(prevs[to_delete]!=-1) nexts[prevs[to_delete]] = nexts[to_delete];
+        }
     }
-    free(t_sems);
-    free(c_sems);
 
-    // Free prev and next sols arrays
-    free(prev_sols);
-    free(next_sols);
+    free(targs);
+    threadpool_barrier_destroy(&barrier);
+    // Free batch data
+    free(polled);
+    free(rolled_pairs);
+    free(rolled_nexts);
+    free(rolled_prevs);
+    free(rolled);
+    free(cand_reused);
+    free(new_pairs);
+    free(cand_polled_pos);
+    free(cand_nexts);
+    free(cand_prevs);
+    free(cand_pairs);
     // Free all the pairs:
-    pairheap_free(heap);
+    for(int i=0;i<run->n_threads;i++) pairheap_free(heaps[i]);
+    free(heaps);
     // Set output final array:
     int new_nsols=0;
     for(int i=0;i<*n_sols;i++){
@@ -26,6 +26,8 @@ void rundata_free(rundata *data){
     runprecomp_free(data->precomp);
     // Free run info
     runinfo_free(data->run_inf);
+    // Terminate the worker threads
+    threadpool_free(data->pool);
     // Free problem
     problem_free(data->prob);
     // Free rundata
@@ -52,6 +54,7 @@ rundata *rundata_init(problem *prob, redstrategy *rstrats, int n_rstrats, int n_
     run->branching_factor     = DEFAULT_BRANCHING_FACTOR;
     run->branching_correction = DEFAULT_BRANCHING_CORRECTION;
     run->path_relinking   = DEFAULT_PATH_RELINKING;
+    run->vr_heap_limit_mb = DEFAULT_VR_HEAP_LIMIT_MB;
 
     run->target_sols  = DEFAULT_TARGET_SOLS;
     run->n_threads    = n_threads;
@@ -63,10 +66,13 @@ rundata *rundata_init(problem *prob, redstrategy *rstrats, int n_rstrats, int n_
     run->local_search_add_movement = DEFAULT_LOCAL_SEARCH_SIZE_CHANGE_MOVEMENTS_ENABLED;
 
     // Initialize runinfo
-    run->run_inf = runinfo_init(prob,n_restarts);
+    run->run_inf = runinfo_init(prob,n_restarts,n_threads);
+
+    // Create the worker threads
+    run->pool = threadpool_init(run->n_threads);
 
     // Initialize precomputations and perform them
-    run->precomp = runprecomp_init(prob,rstrats,n_rstrats,precomp_nearly_indexes,run->n_threads,run->verbose);
+    run->precomp = runprecomp_init(prob,rstrats,n_rstrats,precomp_nearly_indexes,run->pool,run->verbose);
 
     return run;
 }
@@ -78,6 +84,11 @@ void rundata_print(const rundata *run, FILE *fp){
     fprintf(fp,"== PROBLEM ==\n");
     fprintf(fp,"# N_FACILITIES: %d\n",prob->n_facs);
     fprintf(fp,"# N_CLIENTS: %d\n",prob->n_clis);
+    fprintf(fp,"# COST_TYPE: %s\n",COSTVAL_NAME);
+    fprintf(fp,"# FACIDX_TYPE: %s\n",FACIDX_NAME);
+    fprintf(fp,"# LOSSLESS_COSTS: %d\n",prob->lossless_costs);
+    fprintf(fp,"# CACHE_ASSIGN_COSTS: %d\n",prob->cache_assign_costs);
+    fprintf(fp,"# CACHE_FACS_BITS: %d\n",prob->cache_facs_bits);
     fprintf(fp,"# SIZE_RESTRICTION_MINIMUM: %d\n",prob->size_restriction_minimum);
     fprintf(fp,"# SIZE_RESTRICTION_MAXIMUM: %d\n",prob->size_restriction_maximum);
     fprintf(fp,"\n");
@@ -95,6 +106,7 @@ void rundata_print(const rundata *run, FILE *fp){
     fprintf(fp,"# BRANCHING_FACTOR_CORRECTION: %d\n",run->branching_correction);
     fprintf(fp,"# PATH_RELINKING: %s\n",path_relinking_names[run->path_relinking]);
     fprintf(fp,"# PATH_RELINKING_LOCAL_SEARCH: %s\n",local_search_names[run->local_search_pr]);
+    fprintf(fp,"# VR_HEAP_LIMIT_MB: %d\n",run->vr_heap_limit_mb);
     fprintf(fp,"# RANDOM_SEED: %d\n",run->random_seed);
     fprintf(fp,"# RESTARTS: %d\n",run->n_restarts);
     fprintf(fp,"# VERBOSE: %d\n",run->verbose);
@@ -4,6 +4,7 @@
 #include "problem.h"
 #include "runinfo.h"
 #include "runprecomp.h"
+#include "threadpool.h"
 
 #define MAX_FILTER 4
 
@@ -15,6 +16,7 @@
 #define BRANCH_AND_BOUND_DEFAULT 0
 #define DEFAULT_LOCAL_SEARCH_BEFORE_SELECT 1
 #define DEFAULT_SELECT_ONLY_TERMINAL 1
+#define DEFAULT_VR_HEAP_LIMIT_MB 0
 
 // Possible filters after child solutions are created
 typedef enum {
@@ -61,6 +63,8 @@ typedef struct {
     int target_sols;
     // | Number of threads
     int n_threads;
+    // | Worker threads used by all the parallel phases
+    threadpool *pool;
     // | Which local search to perform, if any.
     localsearch local_search;
     // | Which local search to use in path relinking
@@ -85,6 +89,8 @@ typedef struct {
     int branching_correction;
     // If PR is enabled
     pathrelinkingmode path_relinking;
+    // | Memory limit for the pairs of the VR-heuristic in MB, 0 for no limit
+    int vr_heap_limit_mb;
 
     // | Verbose mode
     int verbose;
@@ -1,6 +1,6 @@
 #include "runinfo.h"
 
-runinfo *runinfo_init(const problem *prob, int n_restarts){
+runinfo *runinfo_init(const problem *prob, int n_restarts, int n_threads){
     runinfo *rinf = safe_malloc(sizeof(runinfo));
 
     rinf->firstr_n_iterations      = 0;
@@ -8,7 +8,13 @@ runinfo *runinfo_init(const problem *prob, int n_restarts){
     rinf->n_local_searches         = 0;
     rinf->n_local_search_movements = 0;
     rinf->local_search_seconds     = 0;
+    rinf->expansion_seconds        = 0;
+    rinf->load_seconds             = 0;
+    rinf->n_children_evaluated     = 0;
+    rinf->n_children_materialized  = 0;
     rinf->path_relinking_seconds   = 0;
+    rinf->n_sdbs_dissimilitudes       = 0;
+    rinf->n_sdbs_dissimilitudes_saved = 0;
 
     // First restart data
     rinf->firstr_per_size_n_sols = safe_malloc(sizeof(int)*(prob->n_facs+2));
@@ -26,6 +32,15 @@ runinfo *runinfo_init(const problem *prob, int n_restarts){
         rinf->restart_values[r] = -INFINITY;
     }
 
+    // Thread data
+    rinf->n_threads = n_threads;
+    rinf->thread_busy_seconds = safe_malloc(sizeof(double)*n_threads);
+    rinf->thread_idle_seconds = safe_malloc(sizeof(double)*n_threads);
+    for(int i=0;i<n_threads;i++){
+        rinf->thread_busy_seconds[i] = 0;
+        rinf->thread_idle_seconds[i] = 0;
+    }
+
     return rinf;
 }
 
@@ -37,6 +52,9 @@ void runinfo_free(runinfo *rinf){
     // Free restart data
     free(rinf->restart_times);
     free(rinf->restart_values);
+    // Free thread data
+    free(rinf->thread_busy_seconds);
+    free(rinf->thread_idle_seconds);
     //
     free(rinf);
 }
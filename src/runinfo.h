@@ -20,15 +20,33 @@ typedef struct {
     long long int n_local_search_movements;
     // | CPU time performing local search:
     double local_search_seconds;
+    // | Wall time reading the input problem:
+    double load_seconds;
+    // | Wall time creating the child solutions on expansions (allocation, copy, addition and filtering):
+    double expansion_seconds;
+    // | Number of children whose value was computed before building them on expansions
+    long long int n_children_evaluated;
+    // | Number of children built on expansions
+    long long int n_children_materialized;
+    // | Number of dissimilitudes to the centroids computed on sdbs reductions
+    long long int n_sdbs_dissimilitudes;
+    // | Number of dissimilitudes to the centroids that sdbs reductions avoided with the triangle inequality
+    long long int n_sdbs_dissimilitudes_saved;
     // | Time taken on each restart
     double *restart_times;
     // | Values on each restart
     double *restart_values;
     // | CPU time performing path relinking:
     double path_relinking_seconds;
+    // | Number of threads
+    int n_threads;
+    // | Wall time that each thread spent working on local searches and path relinking
+    double *thread_busy_seconds;
+    // | Wall time that each thread waited for the others to finish their local searches and path relinking
+    double *thread_idle_seconds;
 } runinfo;
 
-runinfo *runinfo_init(const problem *prob, int n_restarts);
+runinfo *runinfo_init(const problem *prob, int n_restarts, int n_threads);
 void runinfo_free(runinfo *rinf);
 
 #endif
@@ -1,45 +1,82 @@
 #include <assert.h>
 
 #include "runprecomp.h"
+#include "kernels.h"
 
 // ============================================================================
 // Facility-facility distance precomputation thread execution
 
+/* The distances are computed on tiles of two blocks of FACS_DIST_BLOCK facilities, one chunk of FACS_DIST_CHUNK clients
+at a time, so that the rows of both blocks on the chunk stay on the cache while all the pairs of the tile are compared,
+each row of the first block with KERNEL_ROWS rows of the second at once.
+The tiles of the upper triangle of the matrix have the same work, and they are claimed dynamically by the threads. */
+#define FACS_DIST_BLOCK 16
+#define FACS_DIST_CHUNK 512
+
 typedef struct {
     runprecomp *pcomp;
     const problem *prob;
-    int thread_id;
-    int n_threads;
     int mode;
+    // | First and second block of each tile (first<=second).
+    const int *tile_blocks;
+    int n_tiles;
+    // | Counter of the next tile, shared by all the threads.
+    int *next_tile;
 } precomp_facs_dist_thread_args;
 
+// Distances of a tile, with room for the rows past the end of the second block that the kernels compare.
+typedef struct {
+    // | Partial sums of FACDIS_SUM_OF_DELTAS, the distance is the same that kernel_l1_distance would give.
+    double sums[FACS_DIST_BLOCK][FACS_DIST_BLOCK+KERNEL_ROWS][KERNEL_SUM_LANES];
+    // | Minimums of FACDIS_MIN_TRIANGLE.
+    double mins[FACS_DIST_BLOCK][FACS_DIST_BLOCK+KERNEL_ROWS];
+} facs_dist_tile;
+
 void *precomp_facs_dist_thread_execution(void *arg){
     precomp_facs_dist_thread_args *args = (precomp_facs_dist_thread_args *) arg;
     const problem *prob = args->prob;
+    double **dists = args->pcomp->facs_distance[args->mode];
+    assert(args->mode==FACDIS_SUM_OF_DELTAS || args->mode==FACDIS_MIN_TRIANGLE);
+    assert(FACS_DIST_CHUNK%KERNEL_SUM_LANES==0);
+    facs_dist_tile *tile = safe_malloc(sizeof(facs_dist_tile));
     // Compute facility-facility distances acording to mode
-    for(int a=args->thread_id;a<prob->n_facs;a+=args->n_threads){
-        for(int b=a;b<prob->n_facs;b++){
-            double dist = 0;
-            if(args->mode==FACDIS_SUM_OF_DELTAS){
-                dist = 0;
-                for(int j=0;j<prob->n_clis;j++){
-                    double delta = problem_assig_value(prob,a,j) - problem_assig_value(prob,b,j);
-                    if(delta<0) delta = -delta;
-                    dist += delta;
-                }
-            }else if(args->mode==FACDIS_MIN_TRIANGLE){
-                dist = INFINITY;
-                for(int j=0;j<prob->n_clis;j++){
-                    double dist_sum = prob->distance_cost[a][j]+prob->distance_cost[b][j];
-                    if(dist_sum<dist) dist = dist_sum;
+    for(int t=threadpool_claim(args->next_tile);t<args->n_tiles;t=threadpool_claim(args->next_tile)){
+        int a0 = args->tile_blocks[2*t]*FACS_DIST_BLOCK;
+        int b0 = args->tile_blocks[2*t+1]*FACS_DIST_BLOCK;
+        int a1 = a0+FACS_DIST_BLOCK<prob->n_facs? a0+FACS_DIST_BLOCK : prob->n_facs;
+        int b1 = b0+FACS_DIST_BLOCK<prob->n_facs? b0+FACS_DIST_BLOCK : prob->n_facs;
+        memset(tile->sums,0,sizeof(tile->sums));
+        for(int a=0;a<FACS_DIST_BLOCK;a++){
+            for(int b=0;b<FACS_DIST_BLOCK+KERNEL_ROWS;b++) tile->mins[a][b] = INFINITY;
+        }
+        for(int c0=0;c0<prob->n_clis;c0+=FACS_DIST_CHUNK){
+            int len = c0+FACS_DIST_CHUNK<prob->n_clis? FACS_DIST_CHUNK : prob->n_clis-c0;
+            for(int a=a0;a<a1;a++){
+                const costval *row_a = problem_assig_row(prob,a)+c0;
+                // Only the upper triangle of the tiles on the diagonal
+                for(int b=(a0==b0? a : b0);b<b1;b+=KERNEL_ROWS){
+                    // Rows past the end of the block repeat the last one, their results are discarded
+                    const costval *rows_b[KERNEL_ROWS];
+                    for(int r=0;r<KERNEL_ROWS;r++) rows_b[r] = problem_assig_row(prob,b+r<b1? b+r : b1-1)+c0;
+                    if(args->mode==FACDIS_SUM_OF_DELTAS){
+                        kernel_l1_rows(len,row_a,rows_b,tile->sums[a-a0][b-b0]);
+                    }else{
+                        kernel_min_sum_rows(len,row_a,rows_b,&tile->mins[a-a0][b-b0]);
+                    }
                 }
-            }else{
-                assert(!"Asked to precompute valid facility distance.");
             }
-            args->pcomp->facs_distance[args->mode][a][b] = dist;
-            args->pcomp->facs_distance[args->mode][b][a] = dist;
+        }
+        for(int a=a0;a<a1;a++){
+            for(int b=(a0==b0? a : b0);b<b1;b++){
+                double dist;
+                if(args->mode==FACDIS_SUM_OF_DELTAS) dist = kernel_sum_lanes(tile->sums[a-a0][b-b0]);
+                else                                 dist = tile->mins[a-a0][b-b0];
+                dists[a][b] = dist;
+                dists[b][a] = dist;
+            }
         }
     }
+    free(tile);
     return NULL;
 }
 
@@ -58,54 +95,159 @@ typedef struct {
     int indx;
 } distpair;
 
-// Compare distpairs by distance
+// Compare distpairs by distance (decreasing value), and by index on ties
 int distpair_cmp(const void *a,const void *b){
     const distpair *aa = a;
     const distpair *bb = b;
     double diff = bb->value - aa->value;
     assert(!isnan(diff));
     if(diff<0) return -1;
-    if(diff==0) return 0;
-    return 1;
+    if(diff>0) return 1;
+    return aa->indx - bb->indx;
+}
+
+// Reorders the pairs so that the k first ones (in any order) are the ones that go first by distpair_cmp; in O(n) expected time
+static void distpair_select(distpair *pairs, int n, int k){
+    int lo = 0;
+    int hi = n-1;
+    while(lo<hi){
+        // Partition around the median of three
+        int mid = lo+(hi-lo)/2;
+        if(distpair_cmp(&pairs[mid],&pairs[lo])<0){ distpair t = pairs[mid]; pairs[mid] = pairs[lo]; pairs[lo] = t; }
+        if(distpair_cmp(&pairs[hi],&pairs[lo])<0){ distpair t = pairs[hi]; pairs[hi] = pairs[lo]; pairs[lo] = t; }
+        if(distpair_cmp(&pairs[hi],&pairs[mid])<0){ distpair t = pairs[hi]; pairs[hi] = pairs[mid]; pairs[mid] = t; }
+        distpair pivot = pairs[mid];
+        int i = lo;
+        int j = hi;
+        while(i<=j){
+            while(distpair_cmp(&pairs[i],&pivot)<0) i++;
+            while(distpair_cmp(&pivot,&pairs[j])<0) j--;
+            if(i<=j){
+                distpair t = pairs[i]; pairs[i] = pairs[j]; pairs[j] = t;
+                i++;
+                j--;
+            }
+        }
+        // Continue on the side with the k-th pair
+        if(k-1<=j) hi = j;
+        else if(k-1>=i) lo = i;
+        else break;
+    }
 }
 
 void *precomp_nearly_indexes_thread_execution(void *arg){
     precomp_nearly_indexes_args *args = (precomp_nearly_indexes_args *) arg;
     const problem *prob = args->prob;
     runprecomp *pcomp = args->pcomp;
+    int size = pcomp->nearly_size;
+    distpair *pairs = safe_malloc(sizeof(distpair)*prob->n_facs);
     // Compute facility indexes sorted by proximity, client-wise.
     for(int i=args->thread_id;i<prob->n_clis;i+=args->n_threads){
         // Initialize array of distpairs with distances and facility indexes
-        distpair *pairs = safe_malloc(sizeof(distpair)*prob->n_facs);
+        const costval *crow = problem_client_row(prob,i);
         for(int f=0;f<prob->n_facs;f++){
-            pairs[f].value = problem_assig_value(prob,f,i);
+            pairs[f].value = -problem_client_assig_cost(prob,crow,f,i);
             pairs[f].indx = f;
         }
-        // Sort pairs by distance
-        qsort(pairs,prob->n_facs,sizeof(distpair),distpair_cmp);
-        assert(prob->n_facs==0 || pairs[0].value >= pairs[prob->n_facs-1].value);
+        // Select the nearest facilities and sort them by distance
+        if(size<prob->n_facs) distpair_select(pairs,prob->n_facs,size);
+        qsort(pairs,size,sizeof(distpair),distpair_cmp);
         // Initialize nearly indexes list
-        for(int k=0;k<prob->n_facs;k++){
+        for(int k=0;k<size;k++){
             pcomp->nearly_indexes[i][k] = pairs[k].indx;
         }
-        assert(prob->n_facs==0 || problem_assig_value(prob,pcomp->nearly_indexes[i][0],i) >= problem_assig_value(prob,pcomp->nearly_indexes[i][prob->n_facs-1],i));
-        // Free pairs data structure
-        free(pairs);
+        #ifdef DEBUG
+            // No facility out of the list is nearer than the last one
+            for(int k=size;k<prob->n_facs;k++) assert(distpair_cmp(&pairs[size-1],&pairs[k])<0);
+        #endif
+        assert(size==0 || problem_assig_value(prob,pcomp->nearly_indexes[i][0],i) >= problem_assig_value(prob,pcomp->nearly_indexes[i][size-1],i));
+    }
+    // Free pairs data structure
+    free(pairs);
+    return NULL;
+}
+
+// ============================================================================
+// Facility neighbors thread execution
+
+typedef struct {
+    runprecomp *pcomp;
+    int thread_id;
+    int n_threads;
+    int mode;
+} precomp_facs_neighbors_args;
+
+void *precomp_facs_neighbors_thread_execution(void *arg){
+    precomp_facs_neighbors_args *args = (precomp_facs_neighbors_args *) arg;
+    runprecomp *pcomp = args->pcomp;
+    int size = pcomp->facs_neighbors_size;
+    // Nearest facilities found so far, by increasing distance
+    distpair *nearest = safe_malloc(sizeof(distpair)*size);
+    for(int a=args->thread_id;a<pcomp->n_facs;a+=args->n_threads){
+        const double *dists = pcomp->facs_distance[args->mode][a];
+        // Insert the facilities nearer than the last one of the list (the facility itself included, as its distance may not be 0),
+        // after the ones with the same distance
+        int n_nearest = 0;
+        for(int b=0;b<pcomp->n_facs;b++){
+            double dist = dists[b];
+            assert(!isnan(dist));
+            if(n_nearest==size && !(dist<nearest[size-1].value)) continue;
+            int pos = n_nearest<size? n_nearest++ : size-1;
+            while(pos>0 && nearest[pos-1].value>dist){
+                nearest[pos] = nearest[pos-1];
+                pos -= 1;
+            }
+            nearest[pos].value = dist;
+            nearest[pos].indx = b;
+        }
+        for(int k=0;k<size;k++){
+            pcomp->facs_neighbors[args->mode][(long long int)a*size+k] = nearest[k].indx;
+        }
     }
+    free(nearest);
     return NULL;
 }
 
 // ============================================================================
+// Sketch projection matrix
 
-runprecomp *runprecomp_init(const problem *prob, redstrategy *rstrats, int n_rstrats, int precomp_nearly_indexes, int n_threads, int verbose){
+// Seed of the projections, fixed so that runs don't depend on how many sketches are used.
+#define SKETCH_SEED 0x5ce7c4u
+
+/* Cauchy random projections preserve the L1 distance: each projection of the difference between
+two cost vectors is a Cauchy variable scaled by their per client delta, that is estimated
+from the projections of both (see solution_dissimilitude). */
+static float *precomp_sketch_matrix(const problem *prob, int sketch_size){
+    float *matrix = safe_malloc(sizeof(float)*prob->n_clis*sketch_size);
+    for(long long int k=0;k<(long long int)prob->n_clis*sketch_size;k++){
+        // Uniform value on (0,1) from the hash of the position, then the standard Cauchy one
+        uint64_t x = hash_fac((int)k)^SKETCH_SEED;
+        x = hash_fac((int)(x^(x>>32)));
+        double u = ((x>>11)+0.5)/9007199254740992.0;
+        matrix[k] = (float) tan(M_PI*(u-0.5));
+    }
+    return matrix;
+}
+
+// ============================================================================
+
+runprecomp *runprecomp_init(const problem *prob, redstrategy *rstrats, int n_rstrats, int precomp_nearly_indexes, threadpool *pool, int verbose){
+    int n_threads = pool->n_threads;
 
     runprecomp *pcomp = safe_malloc(sizeof(runprecomp));
     // Facility distances not yet computed
     for(int mode=0;mode<N_FACDIS_MODES;mode++){
         pcomp->facs_distance[mode] = NULL;
+        pcomp->facs_neighbors[mode] = NULL;
     }
+    pcomp->facs_neighbors_size = prob->n_facs<FACS_NEIGHBORS_SIZE? prob->n_facs : FACS_NEIGHBORS_SIZE;
     // Nearly indexes for each client not yet computed
     pcomp->nearly_indexes = NULL;
+    pcomp->nearly_size = 0;
+    // Sketches not used
+    pcomp->sketch_size = 0;
+    pcomp->sketch_matrix = NULL;
+    pcomp->sketch_scale = 1;
 
     pcomp->n_clis = prob->n_clis;
     pcomp->n_facs = prob->n_facs;
@@ -113,9 +255,10 @@ runprecomp *runprecomp_init(const problem *prob, redstrategy *rstrats, int n_rst
     // Precompute precomp_client_optimal_gain
     pcomp->precomp_client_optimal_gain = 0;
     for(int k=0;k<prob->n_clis;k++){
-        double best_val = problem_assig_value(prob,-1,k);
+        const costval *crow = problem_client_row(prob,k);
+        double best_val = -problem_client_assig_cost(prob,crow,-1,k);
         for(int i=0;i<prob->n_facs;i++){
-            double val = problem_assig_value(prob,i,k);
+            double val = -problem_client_assig_cost(prob,crow,i,k);
             if(best_val < val) best_val = val;
         }
         pcomp->precomp_client_optimal_gain += best_val;
@@ -136,46 +279,80 @@ runprecomp *runprecomp_init(const problem *prob, redstrategy *rstrats, int n_rst
             for(int i=0;i<prob->n_facs;i++){
                 pcomp->facs_distance[mode][i] = safe_malloc(sizeof(double)*prob->n_facs);
             }
-            // Allocate memory for threads and arguments
-            pthread_t *threads = safe_malloc(sizeof(pthread_t)*n_threads);
+            // Tiles of the upper triangle of the matrix
+            int n_blocks = (prob->n_facs+FACS_DIST_BLOCK-1)/FACS_DIST_BLOCK;
+            int n_tiles = 0;
+            int *tile_blocks = safe_malloc(sizeof(int)*2*((long long int)n_blocks*(n_blocks+1)/2+1));
+            for(int bi=0;bi<n_blocks;bi++){
+                for(int bj=bi;bj<n_blocks;bj++){
+                    tile_blocks[2*n_tiles] = bi;
+                    tile_blocks[2*n_tiles+1] = bj;
+                    n_tiles += 1;
+                }
+            }
+            int next_tile = 0;
+            // Allocate memory for arguments
             precomp_facs_dist_thread_args *targs = safe_malloc(sizeof(precomp_facs_dist_thread_args)*n_threads);
             // Call threads to compute facility-facility distances
             for(int i=0;i<n_threads;i++){
                 targs[i].pcomp = pcomp;
                 targs[i].prob  = prob;
-                targs[i].thread_id = i;
-                targs[i].n_threads = n_threads;
                 targs[i].mode = mode;
-
-                int rc = pthread_create(&threads[i],NULL,precomp_facs_dist_thread_execution,&targs[i]);
-                if(rc){
-                    fprintf(stderr,"ERROR: Error %d on pthread_create\n",rc);
-                    exit(1);
-                }
-            }
-            // Join threads
-            for(int i=0;i<n_threads;i++){ // Join threads
-                pthread_join(threads[i],NULL);
+                targs[i].tile_blocks = tile_blocks;
+                targs[i].n_tiles = n_tiles;
+                targs[i].next_tile = &next_tile;
             }
+            threadpool_execute(pool,precomp_facs_dist_thread_execution,targs,sizeof(precomp_facs_dist_thread_args));
             // Free memory
             free(targs);
-            free(threads);
+            free(tile_blocks);
+            // Lists of nearest facilities, from the complete distance matrix
+            pcomp->facs_neighbors[mode] = safe_malloc(sizeof(int)*(long long int)prob->n_facs*pcomp->facs_neighbors_size);
+            precomp_facs_neighbors_args *nargs = safe_malloc(sizeof(precomp_facs_neighbors_args)*n_threads);
+            for(int i=0;i<n_threads;i++){
+                nargs[i].pcomp = pcomp;
+                nargs[i].thread_id = i;
+                nargs[i].n_threads = n_threads;
+                nargs[i].mode = mode;
+            }
+            threadpool_execute(pool,precomp_facs_neighbors_thread_execution,nargs,sizeof(precomp_facs_neighbors_args));
+            free(nargs);
         }
     }
 
+    // Random projections for the sketches of the solutions, all the strategies share them
+    for(int r=0;r<n_rstrats;r++){
+        if(rstrats[r].soldis!=SOLDIS_SKETCH_PER_CLIENT_DELTA) continue;
+        if(pcomp->sketch_size!=0 && pcomp->sketch_size!=rstrats[r].sketch_size){
+            fprintf(stderr,"ERROR: All the rpcd dissimilitudes must use the same sketch size!\n");
+            exit(1);
+        }
+        pcomp->sketch_size = rstrats[r].sketch_size;
+    }
+    if(pcomp->sketch_size>0){
+        if(verbose!=0) printf("\nPrecomputing sketch projections.\n");
+        pcomp->sketch_matrix = precomp_sketch_matrix(prob,pcomp->sketch_size);
+        pcomp->sketch_scale = pow(cos(M_PI/(2*pcomp->sketch_size)),pcomp->sketch_size);
+    }
+
     // Precompute facility indexes by proximity to each client
     if(precomp_nearly_indexes){
         if(pcomp->nearly_indexes==NULL){
             if(verbose!=0){
                 printf("\nPrecomputing nearly indexes.\n");
             }
+            // Length of the lists
+            int min_p = prob->size_restriction_minimum>0? prob->size_restriction_minimum : NEARLY_INDEXES_DEFAULT_P;
+            long long int size = (long long int)NEARLY_INDEXES_FACTOR*prob->n_facs/min_p;
+            if(size<NEARLY_INDEXES_MIN_SIZE) size = NEARLY_INDEXES_MIN_SIZE;
+            if(size>prob->n_facs) size = prob->n_facs;
+            pcomp->nearly_size = (int) size;
             // Initialize memory for the nearly_indexes
-            pcomp->nearly_indexes = safe_malloc(sizeof(int*)*prob->n_clis);
+            pcomp->nearly_indexes = safe_malloc(sizeof(facidx*)*prob->n_clis);
             for(int i=0;i<prob->n_clis;i++){
-                pcomp->nearly_indexes[i] = safe_malloc(sizeof(int)*prob->n_facs);
+                pcomp->nearly_indexes[i] = safe_malloc(sizeof(facidx)*(pcomp->nearly_size>0? pcomp->nearly_size : 1));
             }
-            // Allocate memory for threads and arguments
-            pthread_t *threads = safe_malloc(sizeof(pthread_t)*n_threads);
+            // Allocate memory for arguments
             precomp_nearly_indexes_args *targs = safe_malloc(sizeof(precomp_nearly_indexes_args)*n_threads);
             // Call threads to compute nearly indexes
             for(int i=0;i<n_threads;i++){
@@ -183,19 +360,10 @@ runprecomp *runprecomp_init(const problem *prob, redstrategy *rstrats, int n_rst
                 targs[i].prob  = prob;
                 targs[i].thread_id = i;
                 targs[i].n_threads = n_threads;
-                int rc = pthread_create(&threads[i],NULL,precomp_nearly_indexes_thread_execution,&targs[i]);
-                if(rc){
-                    fprintf(stderr,"ERROR: Error %d on pthread_create\n",rc);
-                    exit(1);
-                }
-            }
-            // Join threads
-            for(int i=0;i<n_threads;i++){ // Join threads
-                pthread_join(threads[i],NULL);
             }
+            threadpool_execute(pool,precomp_nearly_indexes_thread_execution,targs,sizeof(precomp_nearly_indexes_args));
             // Free memory
             free(targs);
-            free(threads);
         }
     }
 
@@ -211,6 +379,7 @@ void runprecomp_free(runprecomp *pcomp){
             }
             free(pcomp->facs_distance[mode]);
         }
+        free(pcomp->facs_neighbors[mode]);
     }
     // Free nearly indexes if it is in use
     if(pcomp->nearly_indexes){
@@ -219,6 +388,7 @@ void runprecomp_free(runprecomp *pcomp){
         }
         free(pcomp->nearly_indexes);
     }
+    free(pcomp->sketch_matrix);
     // Free the precomputation
     free(pcomp);
 }
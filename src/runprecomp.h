@@ -3,6 +3,17 @@
 
 #include "problem.h"
 #include "redstrategy.h"
+#include "threadpool.h"
+
+// Maximum number of neighbors on the lists of nearest facilities of each facility.
+#define FACS_NEIGHBORS_SIZE 64
+
+// The lists of nearest facilities of each client keep NEARLY_INDEXES_FACTOR*n/p facilities (at least NEARLY_INDEXES_MIN_SIZE),
+// where p is the minimum size of the solutions, or NEARLY_INDEXES_DEFAULT_P if it isn't restricted.
+// The second nearest facility of a solution of size p to a client is usually among its first 2n/p facilities.
+#define NEARLY_INDEXES_FACTOR 4
+#define NEARLY_INDEXES_MIN_SIZE 256
+#define NEARLY_INDEXES_DEFAULT_P 32
 
 typedef struct {
     // | Number of facilitites and client to keep the struct independent.
@@ -11,11 +22,23 @@ typedef struct {
     double precomp_client_optimal_gain;
     // | Precomputed distance matrices between facilities (for each mode)
     double **facs_distance[N_FACDIS_MODES];
-    // | Precomputed facility indexes by proximity for each client for Resende and Werneck's local search
-    int **nearly_indexes;
+    // | For each mode with distances, the facs_neighbors_size nearest facilities to each facility by increasing distance
+    //   (the ones of facility f start on f*facs_neighbors_size), to find the nearest facility of a solution without scanning it.
+    int *facs_neighbors[N_FACDIS_MODES];
+    int facs_neighbors_size;
+    // | Precomputed facility indexes by proximity for each client for Resende and Werneck's local search,
+    //   only the nearest nearly_size ones (ties by index).
+    facidx **nearly_indexes;
+    int nearly_size;
+    // | Number of random projections of the sketches of the solutions (0 if they aren't used).
+    int sketch_size;
+    // | Random projection matrix of the sketches, sketch_size standard Cauchy values for each client.
+    float *sketch_matrix;
+    // | Factor that makes the geometric mean of the projections an unbiased estimation, cos(pi/(2 sketch_size))^sketch_size.
+    double sketch_scale;
 } runprecomp;
 
-runprecomp *runprecomp_init(const problem *prob, redstrategy *rstrats, int n_rstrats, int precomp_nearly_indexes, int n_threads, int verbose);
+runprecomp *runprecomp_init(const problem *prob, redstrategy *rstrats, int n_rstrats, int precomp_nearly_indexes, threadpool *pool, int verbose);
 
 void runprecomp_free(runprecomp *pcomp);
 
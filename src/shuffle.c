@@ -40,6 +40,25 @@ void shuffler_reshuffle(shuffler *shu){
     shu->n_retrieved = 0;
 }
 
+void shuffler_reseed(shuffler *shu, uint64_t seed){
+    // Restore the numbers, as reshuffling depends on their previous order
+    for(int i=0;i<shu->len;i++) shu->nums[i] = i;
+    // Expand the seed for the random number generator using splitmix64
+    unsigned char bytes[32];
+    for(int i=0;i<4;i++){
+        seed += 0x9e3779b97f4a7c15ULL;
+        uint64_t x = seed;
+        x = (x^(x>>30))*0xbf58476d1ce4e5b9ULL;
+        x = (x^(x>>27))*0x94d049bb133111ebULL;
+        x = x^(x>>31);
+        for(int b=0;b<8;b++) bytes[8*i+b] = (x>>(8*b))&0xff;
+    }
+    ranxoshi256Seed(&shu->rngen,bytes);
+    // Shuffle everything
+    shu->n_retrieved = shu->len;
+    shuffler_reshuffle(shu);
+}
+
 void shuffler_free(shuffler *shu){
     free(shu->nums);
     free(shu);
@@ -25,6 +25,9 @@ unsigned int shuffler_next(shuffler *shu);
 // Shuffles numbers again, already retrieved numbers are restored
 void shuffler_reshuffle(shuffler *shu);
 
+// Restarts the shuffler from the given seed, so that the numbers it retrieves only depend on it
+void shuffler_reseed(shuffler *shu, uint64_t seed);
+
 // Free shuffler's memory
 void shuffler_free(shuffler *shu);
 
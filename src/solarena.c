@@ -0,0 +1,141 @@
+#include "solarena.h"
+
+// Rounds a size up to a multiple of 64 bytes, so that every array on a slot starts on a cache line.
+static size_t solarena_round(size_t size){
+    return (size+63)/64*64;
+}
+
+solarena_pool *solarena_pool_init(){
+    solarena_pool *pool = safe_malloc(sizeof(solarena_pool));
+    pthread_mutex_init(&pool->mutex,NULL);
+    pool->blocks = NULL;
+    pool->n_blocks = 0;
+    return pool;
+}
+
+void solarena_pool_free(solarena_pool *pool){
+    for(int b=0;b<pool->n_blocks;b++) free(pool->blocks[b]);
+    free(pool->blocks);
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool);
+}
+
+// Gets a block for the arena, from its pool if possible.
+static char *solarena_get_block(solarena *arena){
+    if(arena->block_size==SOLARENA_BLOCK_SIZE){
+        char *block = NULL;
+        pthread_mutex_lock(&arena->pool->mutex);
+        if(arena->pool->n_blocks>0){
+            arena->pool->n_blocks -= 1;
+            block = arena->pool->blocks[arena->pool->n_blocks];
+        }
+        pthread_mutex_unlock(&arena->pool->mutex);
+        if(block!=NULL) return block;
+    }
+    return safe_aligned_malloc(64,arena->block_size);
+}
+
+solarena *solarena_init(const problem *prob, int max_facs, int sketch_size, int n_threads, solarena_pool *pool){
+    solarena *arena = safe_malloc(sizeof(solarena));
+    arena->n_clis = prob->n_clis;
+    arena->max_facs = max_facs;
+    arena->cache_assign_costs = prob->cache_assign_costs;
+    arena->facs_words = prob->cache_facs_bits? bitset_words(prob->n_facs) : 0;
+    arena->sketch_size = sketch_size;
+    // Layout of each slot
+    arena->facs_offset    = solarena_round(sizeof(solution));
+    arena->bits_offset    = arena->facs_offset + solarena_round(sizeof(int)*(max_facs>0? max_facs : 1));
+    arena->assigns_offset = arena->bits_offset + solarena_round(sizeof(uint64_t)*arena->facs_words);
+    arena->costs_offset   = arena->assigns_offset + solarena_round(sizeof(facidx)*prob->n_clis);
+    arena->sketch_offset  = arena->costs_offset;
+    if(arena->cache_assign_costs) arena->sketch_offset += solarena_round(sizeof(costval)*prob->n_clis);
+    arena->stride = arena->sketch_offset + solarena_round(sizeof(double)*sketch_size);
+    arena->pool = pool;
+    arena->block_size = SOLARENA_BLOCK_SIZE;
+    if(arena->stride>arena->block_size) arena->block_size = arena->stride;
+    arena->slots_per_block = arena->block_size/arena->stride;
+    // No blocks are allocated until they are needed
+    arena->n_threads = n_threads;
+    arena->threads = safe_aligned_malloc(64,sizeof(solarena_thread)*n_threads);
+    for(int i=0;i<n_threads;i++){
+        arena->threads[i].blocks = NULL;
+        arena->threads[i].n_blocks = 0;
+        arena->threads[i].n_used = 0;
+    }
+    return arena;
+}
+
+solution *solarena_copy(solarena *arena, int thread_id, const problem *prob, const solution *sol){
+    assert(sol->n_facs<=arena->max_facs);
+    assert((sol->assign_costs!=NULL)==arena->cache_assign_costs);
+    solarena_thread *thr = &arena->threads[thread_id];
+    // Get a new block if the current one is full
+    if(thr->n_blocks==0 || thr->n_used==arena->slots_per_block){
+        thr->blocks = safe_realloc(thr->blocks,sizeof(char *)*(thr->n_blocks+1));
+        thr->blocks[thr->n_blocks] = solarena_get_block(arena);
+        thr->n_blocks += 1;
+        thr->n_used = 0;
+    }
+    // Bump allocate the slot
+    char *slot = thr->blocks[thr->n_blocks-1] + arena->stride*thr->n_used;
+    thr->n_used += 1;
+    // Copy the solution on it
+    solution *sol2 = (solution *) slot;
+    sol2->facs = (int *)(slot+arena->facs_offset);
+    sol2->facs_bits = NULL;
+    if(arena->facs_words>0) sol2->facs_bits = (uint64_t *)(slot+arena->bits_offset);
+    sol2->facs_words = arena->facs_words;
+    sol2->assigns = (facidx *)(slot+arena->assigns_offset);
+    sol2->assign_costs = NULL;
+    if(arena->cache_assign_costs) sol2->assign_costs = (costval *)(slot+arena->costs_offset);
+    sol2->sketch = NULL;
+    if(arena->sketch_size>0) sol2->sketch = (double *)(slot+arena->sketch_offset);
+    sol2->in_arena = 1;
+    solarena_overwrite(arena,prob,sol2,sol);
+    return sol2;
+}
+
+void solarena_overwrite(const solarena *arena, const problem *prob, solution *dst, const solution *sol){
+    assert(dst->in_arena);
+    assert(sol->n_facs<=arena->max_facs);
+    assert((sol->assign_costs!=NULL)==arena->cache_assign_costs);
+    assert(sol->facs_words==arena->facs_words);
+    dst->n_facs = sol->n_facs;
+    memcpy(dst->facs,sol->facs,sizeof(int)*sol->n_facs);
+    if(arena->facs_words>0) memcpy(dst->facs_bits,sol->facs_bits,sizeof(uint64_t)*arena->facs_words);
+    memcpy(dst->assigns,sol->assigns,sizeof(facidx)*prob->n_clis);
+    if(arena->cache_assign_costs){
+        memcpy(dst->assign_costs,sol->assign_costs,sizeof(costval)*prob->n_clis);
+    }
+    dst->value = sol->value;
+    dst->terminal = sol->terminal;
+    dst->hash = sol->hash;
+    dst->sketch_valid = sol->sketch_valid && arena->sketch_size>0;
+    if(dst->sketch_valid) memcpy(dst->sketch,sol->sketch,sizeof(double)*arena->sketch_size);
+}
+
+void solarena_pop(solarena *arena, int thread_id, solution *sol){
+    solarena_thread *thr = &arena->threads[thread_id];
+    assert(thr->n_used>0);
+    assert((char *)sol == thr->blocks[thr->n_blocks-1]+arena->stride*(thr->n_used-1));
+    thr->n_used -= 1;
+}
+
+void solarena_free(solarena *arena){
+    // Return the blocks to the pool if they have its size
+    int to_pool = arena->block_size==SOLARENA_BLOCK_SIZE;
+    for(int i=0;i<arena->n_threads;i++){
+        solarena_thread *thr = &arena->threads[i];
+        if(to_pool && thr->n_blocks>0){
+            solarena_pool *pool = arena->pool;
+            pool->blocks = safe_realloc(pool->blocks,sizeof(char *)*(pool->n_blocks+thr->n_blocks));
+            memcpy(&pool->blocks[pool->n_blocks],thr->blocks,sizeof(char *)*thr->n_blocks);
+            pool->n_blocks += thr->n_blocks;
+        }else{
+            for(int b=0;b<thr->n_blocks;b++) free(thr->blocks[b]);
+        }
+        free(thr->blocks);
+    }
+    free(arena->threads);
+    free(arena);
+}
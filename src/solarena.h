@@ -0,0 +1,81 @@
+#ifndef DC_SOLARENA_H
+#define DC_SOLARENA_H
+
+#include "utils.h"
+#include "solution.h"
+
+/*
+An arena holds the solutions of a generation. Each thread bump-allocates solutions
+(header, facs, facs_bits, assigns, assign_costs and sketch on a single slot of fixed stride) from its own
+blocks, so no locking is needed.
+Solutions in an arena are not released by solution_free, but all at once with solarena_free,
+and they can't have more than max_facs facilities, so they must be copied to the heap
+(with solution_copy) before performing local searches on them.
+The blocks of freed arenas go to a pool where the next arenas take them, so their pages
+don't have to be faulted in again on each generation.
+*/
+
+// Size of the blocks of memory of each thread (larger if a single solution doesn't fit).
+#define SOLARENA_BLOCK_SIZE (1<<21)
+
+// Pool of free blocks of SOLARENA_BLOCK_SIZE bytes, shared by the arenas.
+typedef struct {
+    pthread_mutex_t mutex;
+    char **blocks;
+    int n_blocks;
+} solarena_pool;
+
+typedef struct {
+    // | Blocks allocated by this thread, the last one is the current.
+    char **blocks;
+    int n_blocks;
+    // | Number of slots used on the current block.
+    int n_used;
+} __attribute__((aligned(64))) solarena_thread; // Aligned to avoid false sharing between threads.
+
+typedef struct {
+    // | Number of clients of the problem.
+    int n_clis;
+    // | Maximum number of facilities of each solution.
+    int max_facs;
+    // | If solutions cache their assignment costs.
+    int cache_assign_costs;
+    // | Number of words of the facility bitsets of the solutions, 0 if they don't have them.
+    int facs_words;
+    // | Size of the sketches of the solutions, 0 if they don't have space for them.
+    int sketch_size;
+    // | Size of each slot and offset of each array on it.
+    size_t stride, facs_offset, bits_offset, assigns_offset, costs_offset, sketch_offset;
+    // | Number of slots per block and size of each block.
+    int slots_per_block;
+    size_t block_size;
+    // | Pool where blocks are taken from and returned to (only if block_size is SOLARENA_BLOCK_SIZE).
+    solarena_pool *pool;
+    // | Data for each thread.
+    int n_threads;
+    solarena_thread *threads;
+} solarena;
+
+// Creates an empty pool of blocks.
+solarena_pool *solarena_pool_init();
+
+// Frees a pool and all its blocks, arenas using it must be freed before.
+void solarena_pool_free(solarena_pool *pool);
+
+// Creates an arena for solutions of up to max_facs facilities and sketches of sketch_size values,
+// for the given number of threads.
+solarena *solarena_init(const problem *prob, int max_facs, int sketch_size, int n_threads, solarena_pool *pool);
+
+// Creates a solution on the arena copying another, from the blocks of the given thread.
+solution *solarena_copy(solarena *arena, int thread_id, const problem *prob, const solution *sol);
+
+// Overwrites a solution of the arena with a copy of another, reusing its slot.
+void solarena_overwrite(const solarena *arena, const problem *prob, solution *dst, const solution *sol);
+
+// Releases the last solution created by the given thread, so its slot is reused.
+void solarena_pop(solarena *arena, int thread_id, solution *sol);
+
+// Frees the arena and all the solutions on it.
+void solarena_free(solarena *arena);
+
+#endif
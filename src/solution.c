@@ -14,8 +14,14 @@ int solutionp_facs_cmp(const void *a, const void *b){
     const solution **bb = (const solution **) b;
     const solution *sol1 = *aa;
     const solution *sol2 = *bb;
+    // Different hashes mean different facilities
+    if(sol1->hash!=sol2->hash) return sol1->hash>sol2->hash? +1 : -1;
     int d = sol1->n_facs - sol2->n_facs;
     if(d!=0) return d;
+    if(sol1->facs_bits!=NULL && sol2->facs_bits!=NULL){
+        assert(sol1->facs_words==sol2->facs_words);
+        return memcmp(sol1->facs_bits,sol2->facs_bits,sizeof(uint64_t)*sol1->facs_words);
+    }
     for(int i=0;i<sol1->n_facs;i++){
         d = sol1->facs[i]-sol2->facs[i];
         if(d!=0) return d;
@@ -27,16 +33,34 @@ solution *solution_empty(const problem *prob){
     solution *sol = safe_malloc(sizeof(solution));
     sol->n_facs = 0;
     sol->facs = safe_malloc(sizeof(int)*1);
-    sol->assigns = safe_malloc(sizeof(int)*prob->n_clis);
+    sol->facs_bits = NULL;
+    sol->facs_words = 0;
+    if(prob->cache_facs_bits){
+        sol->facs_words = bitset_words(prob->n_facs);
+        sol->facs_bits = safe_malloc(sizeof(uint64_t)*sol->facs_words);
+        memset(sol->facs_bits,0,sizeof(uint64_t)*sol->facs_words);
+    }
+    sol->assigns = safe_malloc(sizeof(facidx)*prob->n_clis);
+    sol->assign_costs = NULL;
     for(int j=0;j<prob->n_clis;j++){
         sol->assigns[j] = -1;
     }
+    if(prob->cache_assign_costs){
+        sol->assign_costs = safe_malloc(sizeof(costval)*prob->n_clis);
+        for(int j=0;j<prob->n_clis;j++){
+            sol->assign_costs[j] = problem_assig_cost(prob,-1,j);
+        }
+    }
     // Initialize solution value
     sol->value = 0;
     for(int j=0;j<prob->n_clis;j++){
         sol->value += problem_assig_value(prob,-1,j);
     }
     sol->terminal = 0;
+    sol->in_arena = 0;
+    sol->hash = 0;
+    sol->sketch = NULL;
+    sol->sketch_valid = 0;
     return sol;
 }
 
@@ -45,49 +69,127 @@ solution *solution_copy(const problem *prob, const solution *sol){
     sol2->n_facs = sol->n_facs;
     sol2->facs =    safe_malloc(sizeof(int)*sol->n_facs);
     memcpy(sol2->facs,sol->facs,sizeof(int)*sol->n_facs);
-    sol2->assigns = safe_malloc(sizeof(int)*prob->n_clis);
-    memcpy(sol2->assigns,sol->assigns,sizeof(int)*prob->n_clis);
+    sol2->facs_bits = NULL;
+    sol2->facs_words = sol->facs_words;
+    if(sol->facs_bits!=NULL){
+        sol2->facs_bits = safe_malloc(sizeof(uint64_t)*sol->facs_words);
+        memcpy(sol2->facs_bits,sol->facs_bits,sizeof(uint64_t)*sol->facs_words);
+    }
+    sol2->assigns = safe_malloc(sizeof(facidx)*prob->n_clis);
+    memcpy(sol2->assigns,sol->assigns,sizeof(facidx)*prob->n_clis);
+    sol2->assign_costs = NULL;
+    if(sol->assign_costs!=NULL){
+        sol2->assign_costs = safe_malloc(sizeof(costval)*prob->n_clis);
+        memcpy(sol2->assign_costs,sol->assign_costs,sizeof(costval)*prob->n_clis);
+    }
     sol2->value = sol->value;
     sol2->terminal = sol->terminal;
+    sol2->in_arena = 0;
+    sol2->hash = sol->hash;
+    // The sketch isn't copied, as copies are usually modified
+    sol2->sketch = NULL;
+    sol2->sketch_valid = 0;
     return sol2;
 }
 
+// Computes the value of a solution from scratch, using its assignment costs.
+static double solution_compute_value(const problem *prob, const solution *sol){
+    double value = 0;
+    for(int c=0;c<prob->n_clis;c++){
+        value -= solution_assig_cost(prob,sol,c);
+    }
+    for(int i=0;i<sol->n_facs;i++){
+        value -= prob->facility_cost[sol->facs[i]];
+    }
+    return value;
+}
+
 void solution_add(const problem *prob, solution *sol, int newf, int *affected){
     // Check if f is already on the solution:
-    for(int f=0;f<sol->n_facs;f++){
-        if(sol->facs[f]==newf){
-            return;
+    if(sol->facs_bits!=NULL){
+        if(bitset_test(sol->facs_bits,newf)) return;
+    }else{
+        for(int f=0;f<sol->n_facs;f++){
+            if(sol->facs[f]==newf){
+                return;
+            }
         }
     }
-    // Extend array of facilities
-    sol->facs = safe_realloc(sol->facs,sizeof(int)*(sol->n_facs+1));
+    // Extend array of facilities (solutions on arenas already have space for it)
+    if(!sol->in_arena) sol->facs = safe_realloc(sol->facs,sizeof(int)*(sol->n_facs+1));
     // Add facility to the solution
     add_to_sorted(sol->facs,&sol->n_facs,newf);
-    // | New value after adding the new facility.
-    double value2 = 0;
-    // Reassign clients to the new instalation
-    for(int c=0;c<prob->n_clis;c++){
-        double val_pre = problem_assig_value(prob,sol->assigns[c],c);
-        double val_pos = problem_assig_value(prob,newf,c);
-        if(val_pos>val_pre){
-            sol->assigns[c] = newf;
-            value2 += val_pos;
-        }else{
-            value2 += val_pre;
+    if(sol->facs_bits!=NULL) bitset_set(sol->facs_bits,newf);
+    sol->hash ^= hash_fac(newf);
+    sol->sketch_valid = 0;
+    // Reassign clients to the new instalation, getting the change on their assignment costs
+    const costval *newf_row = problem_assig_row(prob,newf);
+    double delta = 0;
+    if(sol->assign_costs!=NULL){
+        delta = kernel_add_sweep(prob->n_clis,newf_row,sol->assign_costs,sol->assigns,newf);
+    }else{
+        // Same summation order than the kernel
+        double partial[KERNEL_SUM_LANES] = {0};
+        for(int c=0;c<prob->n_clis;c++){
+            double cost_pre = problem_assig_cost(prob,sol->assigns[c],c);
+            if(newf_row[c]<cost_pre){
+                partial[c%KERNEL_SUM_LANES] += newf_row[c]-cost_pre;
+                sol->assigns[c] = newf;
+            }
         }
+        delta = kernel_sum_lanes(partial);
     }
-    // Cost of facilities
-    for(int i=0;i<sol->n_facs;i++){
-        value2 -= prob->facility_cost[sol->facs[i]];
-    }
+    // | New value after adding the new facility.
+    double value2 = sol->value - delta - prob->facility_cost[newf];
+    // The value isn't finite while there are unassigned clients, then it has to be recomputed
+    if(!isfinite(value2)) value2 = solution_compute_value(prob,sol);
     // Update solution value
     sol->value = value2;
 }
 
+double solution_value_after_add(const problem *prob, const solution *sol, int newf){
+    const costval *newf_row = problem_assig_row(prob,newf);
+    // Same change on the assignment costs that solution_add would get
+    double delta = 0;
+    if(sol->assign_costs!=NULL){
+        delta = kernel_add_delta(prob->n_clis,newf_row,sol->assign_costs);
+    }else{
+        double partial[KERNEL_SUM_LANES] = {0};
+        for(int c=0;c<prob->n_clis;c++){
+            double cost_pre = problem_assig_cost(prob,sol->assigns[c],c);
+            if(newf_row[c]<cost_pre) partial[c%KERNEL_SUM_LANES] += newf_row[c]-cost_pre;
+        }
+        delta = kernel_sum_lanes(partial);
+    }
+    double value2 = sol->value - delta - prob->facility_cost[newf];
+    if(!isfinite(value2)){
+        // Compute the value from scratch, in the same order that solution_compute_value would
+        value2 = 0;
+        for(int c=0;c<prob->n_clis;c++){
+            double cost_pre = solution_assig_cost(prob,sol,c);
+            value2 -= newf_row[c]<cost_pre? newf_row[c] : cost_pre;
+        }
+        int newf_added = 0;
+        for(int i=0;i<sol->n_facs;i++){
+            assert(sol->facs[i]!=newf);
+            if(!newf_added && newf<sol->facs[i]){
+                value2 -= prob->facility_cost[newf];
+                newf_added = 1;
+            }
+            value2 -= prob->facility_cost[sol->facs[i]];
+        }
+        if(!newf_added) value2 -= prob->facility_cost[newf];
+    }
+    return value2;
+}
+
 void solution_remove(const problem *prob, solution *sol, int remf, int *phi2, int *affected){
     rem_of_sorted(sol->facs,&sol->n_facs,remf);
-    // New value after adding the new facility
-    double value2 = 0;
+    if(sol->facs_bits!=NULL) bitset_clear(sol->facs_bits,remf);
+    sol->hash ^= hash_fac(remf);
+    sol->sketch_valid = 0;
+    // Change on the assignment costs
+    double delta = 0;
     // Drop clients of the facility.
     for(int c=0;c<prob->n_clis;c++){
         // If the client was owned by the facility reassing
@@ -109,36 +211,121 @@ void solution_remove(const problem *prob, solution *sol, int remf, int *phi2, in
                     }
                 }
             }
+            // Change on the cost of the assignment
+            delta += -reassign_value - solution_assig_cost(prob,sol,c);
             // Reassign client
             sol->assigns[c] = reassign;
-            // Value of new assigment
-            value2 += reassign_value;
-        }else{
-            // Value of the current assignment
-            value2 += problem_assig_value(prob,sol->assigns[c],c);
+            if(sol->assign_costs!=NULL) sol->assign_costs[c] = -reassign_value;
         }
     }
-    // The facility costs
-    for(int i=0;i<sol->n_facs;i++){
-        value2 -= prob->facility_cost[sol->facs[i]];
-    }
+    // | New value after removing the facility.
+    double value2 = sol->value - delta + prob->facility_cost[remf];
+    // The value isn't finite if a client is left unassigned, then it has to be recomputed
+    if(!isfinite(value2)) value2 = solution_compute_value(prob,sol);
     // Update solution value
     sol->value = value2;
 }
 
+void solution_sketch_compute(const rundata *run, solution *sol){
+    int sketch_size = run->precomp->sketch_size;
+    assert(sketch_size>0);
+    if(sol->sketch==NULL) sol->sketch = safe_malloc(sizeof(double)*sketch_size);
+    for(int i=0;i<sketch_size;i++) sol->sketch[i] = 0;
+    for(int c=0;c<run->prob->n_clis;c++){
+        double cost = solution_assig_cost(run->prob,sol,c);
+        // Unassigned clients (only on the empty solution) are left out
+        if(!isfinite(cost)) continue;
+        const float *proj = &run->precomp->sketch_matrix[(long long int)c*sketch_size];
+        for(int i=0;i<sketch_size;i++) sol->sketch[i] += proj[i]*cost;
+    }
+    sol->sketch_valid = 1;
+}
+
+void solution_sketch_update(const rundata *run, solution *sol, const solution *origin){
+    int sketch_size = run->precomp->sketch_size;
+    assert(sketch_size>0);
+    if(!origin->sketch_valid){
+        solution_sketch_compute(run,sol);
+        return;
+    }
+    if(sol->sketch==NULL) sol->sketch = safe_malloc(sizeof(double)*sketch_size);
+    if(sol->sketch!=origin->sketch) memcpy(sol->sketch,origin->sketch,sizeof(double)*sketch_size);
+    for(int c=0;c<run->prob->n_clis;c++){
+        if(sol->assigns[c]==origin->assigns[c]) continue;
+        double delta = solution_assig_cost(run->prob,sol,c)-solution_assig_cost(run->prob,origin,c);
+        if(!isfinite(delta)){
+            solution_sketch_compute(run,sol);
+            return;
+        }
+        const float *proj = &run->precomp->sketch_matrix[(long long int)c*sketch_size];
+        for(int i=0;i<sketch_size;i++) sol->sketch[i] += proj[i]*delta;
+    }
+    sol->sketch_valid = 1;
+}
+
 void solution_free(solution *sol){
+    // Solutions on arenas are released with the arena
+    if(sol->in_arena) return;
     free(sol->facs);
+    free(sol->facs_bits);
     free(sol->assigns);
+    free(sol->assign_costs);
+    free(sol->sketch);
     free(sol);
 }
 
+/* The differences between the projections of two solutions are Cauchy variables scaled by their per client delta D,
+and the mean of the logarithms of their absolute values estimates log(D) (the geometric mean estimator, that unlike
+the sample mean isn't affected by the heavy tails, and unlike the median doesn't need a selection). */
+static double sketch_estimate_delta(const runprecomp *precomp, const double *sketch1, const double *sketch2){
+    double sum_log2 = kernel_log2_delta_sum(precomp->sketch_size,sketch1,sketch2);
+    return precomp->sketch_scale*exp2(sum_log2/precomp->sketch_size);
+}
+
+/* If the nearest facility of sol to another one should be found walking the neighbors of the other facility until one is
+on sol: it takes about n_facs/sol->n_facs steps (as the facilities of sol are a fraction of all of them), instead of the
+sol->n_facs of a scan. */
+static int solution_walks_neighbors(const rundata *run, facdismode fdismode, const solution *sol){
+    if(run->precomp->facs_neighbors[fdismode]==NULL || sol->facs_bits==NULL) return 0;
+    return run->prob->n_facs < sol->n_facs*sol->n_facs;
+}
+
+// Approximate number of steps to find the nearest facility of sol to another one.
+static double solution_nearest_steps(const rundata *run, facdismode fdismode, const solution *sol){
+    if(!solution_walks_neighbors(run,fdismode,sol)) return sol->n_facs;
+    double steps = (double) run->prob->n_facs/sol->n_facs;
+    return steps<run->precomp->facs_neighbors_size? steps : run->precomp->facs_neighbors_size;
+}
+
+// Distance from the facility f to the nearest facility of sol (INFINITY if it is empty).
+static double solution_nearest_distance(const rundata *run, facdismode fdismode, int f, const solution *sol){
+    const runprecomp *precomp = run->precomp;
+    const double *dists = precomp->facs_distance[fdismode][f];
+    if(solution_walks_neighbors(run,fdismode,sol)){
+        const int *neighs = &precomp->facs_neighbors[fdismode][(long long int)f*precomp->facs_neighbors_size];
+        for(int k=0;k<precomp->facs_neighbors_size;k++){
+            if(bitset_test(sol->facs_bits,neighs[k])) return dists[neighs[k]];
+        }
+        // None of the nearest facilities is on sol, scan it
+    }
+    double min_dist = INFINITY;
+    for(int k=0;k<sol->n_facs;k++){
+        double dist = dists[sol->facs[k]];
+        if(dist<min_dist) min_dist = dist;
+    }
+    return min_dist;
+}
+
 // Compute the distance between two solutions
 double solution_dissimilitude(const rundata *run,
         const solution *sol1, const solution *sol2,
         soldismode sdismode, facdismode fdismode){
     // The auto case picks the sdismode
     if(sdismode==SOLDIS_AUTO){
-        if(sol1->n_facs*sol2->n_facs <= 15*run->prob->n_clis){
+        // Steps to find the nearest facilities of MGE, without the neighbor lists it is sol1->n_facs*sol2->n_facs
+        double mge_steps = (sol1->n_facs*solution_nearest_steps(run,fdismode,sol2)
+            + sol2->n_facs*solution_nearest_steps(run,fdismode,sol1))/2;
+        if(mge_steps <= 15*run->prob->n_clis){
             sdismode = SOLDIS_MEAN_GEOMETRIC_ERROR;
         }else{
             sdismode = SOLDIS_PER_CLIENT_DELTA;
@@ -165,24 +352,12 @@ double solution_dissimilitude(const rundata *run,
                 i2 += 1;
             }else if(s1f<s2f){
                 // Add delta from s1f to sol2
-                double min_dist = INFINITY;
-                for(int k=0;k<sol2->n_facs;k++){
-                    int f2 = sol2->facs[k];
-                    double dist = run->precomp->facs_distance[fdismode][s1f][f2];
-                    if(dist<min_dist) min_dist = dist;
-                }
-                disim += min_dist;
+                disim += solution_nearest_distance(run,fdismode,s1f,sol2);
                 //
                 i1 += 1;
             }else{
                 // Add delta from s2f to sol1
-                double min_dist = INFINITY;
-                for(int k=0;k<sol1->n_facs;k++){
-                    int f1 = sol1->facs[k];
-                    double dist = run->precomp->facs_distance[fdismode][s2f][f1];
-                    if(dist<min_dist) min_dist = dist;
-                }
-                disim += min_dist;
+                disim += solution_nearest_distance(run,fdismode,s2f,sol1);
                 //
                 i2 += 1;
             }
@@ -213,14 +388,19 @@ double solution_dissimilitude(const rundata *run,
         }
         double disim = 0;
         for(int t=0;t<2;t++){
+            int walk = solution_walks_neighbors(run,fdismode,sol2);
             for(int i1=0;i1<sol1->n_facs;i1++){
                 int f1 = sol1->facs[i1];
                 double cmin = INFINITY;
-                for(int i2=0;i2<sol2->n_facs;i2++){
-                    int f2 = sol2->facs[i2];
-                    double dist = run->precomp->facs_distance[fdismode][f1][f2];
-                    if(dist<cmin) cmin = dist;
-                    if(cmin<disim) break;
+                if(walk){
+                    cmin = solution_nearest_distance(run,fdismode,f1,sol2);
+                }else{
+                    for(int i2=0;i2<sol2->n_facs;i2++){
+                        int f2 = sol2->facs[i2];
+                        double dist = run->precomp->facs_distance[fdismode][f1][f2];
+                        if(dist<cmin) cmin = dist;
+                        if(cmin<disim) break;
+                    }
                 }
                 if(disim<cmin && cmin<INFINITY) disim = cmin;
             }
@@ -230,17 +410,31 @@ double solution_dissimilitude(const rundata *run,
         return disim;
     }
     else if(sdismode==SOLDIS_PER_CLIENT_DELTA){
-        double total = 0;
+        // Vectorized kernel over the cached assignment costs
+        if(sol1->assign_costs!=NULL && sol2->assign_costs!=NULL){
+            return kernel_l1_distance(run->prob->n_clis,sol1->assign_costs,sol2->assign_costs);
+        }
+        // Same partial sums as the kernel, so that the result doesn't depend on the cache
+        double partial[KERNEL_SUM_LANES] = {0};
         for(int i=0;i<run->prob->n_clis;i++){
-            double cost_a = problem_assig_value(run->prob,sol1->assigns[i],i);
-            double cost_b = problem_assig_value(run->prob,sol2->assigns[i],i);
+            double cost_a = solution_assig_cost(run->prob,sol1,i);
+            double cost_b = solution_assig_cost(run->prob,sol2,i);
             double delta = cost_a-cost_b;
             if(delta<0) delta = -delta;
-            total += delta;
+            partial[i%KERNEL_SUM_LANES] += delta;
         }
-        return total;
+        return kernel_sum_lanes(partial);
+    }else if(sdismode==SOLDIS_SKETCH_PER_CLIENT_DELTA){
+        // The sketches are computed before the reductions that use them
+        assert(sol1->sketch_valid && sol2->sketch_valid);
+        return sketch_estimate_delta(run->precomp,sol1->sketch,sol2->sketch);
     }else if(sdismode==SOLDIS_INDEXES_VALUE){
-        int delta = diff_sorted(sol1->facs,sol1->n_facs,sol2->facs,sol2->n_facs);
+        int delta;
+        if(sol1->facs_bits!=NULL && sol2->facs_bits!=NULL){
+            delta = bitset_diff(sol1->facs_bits,sol2->facs_bits,sol1->facs_words);
+        }else{
+            delta = diff_sorted(sol1->facs,sol1->n_facs,sol2->facs,sol2->n_facs);
+        }
         double value_delta = sol1->value - sol2->value;
         if(value_delta<0) value_delta *= -1;
         // Use the number of different indexes as dissimilitude and the value to break ties
@@ -290,10 +484,11 @@ void solution_findout(const problem *prob, const solution *sol, int f_ins, doubl
         v[sol->facs[k]] = -prob->facility_cost[sol->facs[k]];
     }
     //
+    const costval *f_ins_row = problem_assig_row(prob,f_ins);
     for(int u=0;u<prob->n_clis;u++){
         int phi1u = sol->assigns[u];
-        double assig_f_ins_value = problem_assig_value(prob,f_ins,u);
-        double assig_phi1u_value = problem_assig_value(prob,phi1u,u);
+        double assig_f_ins_value = -f_ins_row[u];
+        double assig_phi1u_value = -solution_assig_cost(prob,sol,u);
         double delta = assig_f_ins_value - assig_phi1u_value;
         if(delta>=0){ // Profit by adding f_ins, because it is nearly.
             w += delta;
@@ -365,20 +560,46 @@ int solution_check_integrity(const problem *prob, const solution *sol){
             if(current_value < other_value) integrity = 0;
         }
     }
-    // Check that he value corresponds with the stored value
+    // Check that the cached assignment costs correspond to the assignments
+    for(int j=0;j<prob->n_clis && sol->assign_costs!=NULL;j++){
+        if(sol->assign_costs[j]!=problem_assig_cost(prob,sol->assigns[j],j)) integrity = 0;
+    }
+    // Check that the hash corresponds to the facilities
+    uint64_t hash = 0;
+    for(int k=0;k<sol->n_facs;k++) hash ^= hash_fac(sol->facs[k]);
+    if(hash!=sol->hash) integrity = 0;
+    // Check that the bitset corresponds to the facilities
+    if(sol->facs_bits!=NULL){
+        int n_bits = 0;
+        for(int w=0;w<sol->facs_words;w++) n_bits += __builtin_popcountll(sol->facs_bits[w]);
+        if(n_bits!=sol->n_facs) integrity = 0;
+        for(int k=0;k<sol->n_facs;k++){
+            if(!bitset_test(sol->facs_bits,sol->facs[k])) integrity = 0;
+        }
+    }
+    // Check that he value corresponds with the stored value, and with the full precision costs if they are kept,
+    // so that the rounding of the stored costs is detected too
     double value = 0;
+    double exact_value = 0;
     for(int j=0;j<prob->n_clis;j++){
         value += problem_assig_value(prob,sol->assigns[j],j);
+        exact_value -= problem_exact_assig_cost(prob,sol->assigns[j],j);
     }
     for(int k=0;k<sol->n_facs;k++){
         int f = sol->facs[k];
         value -= prob->facility_cost[f];
+        exact_value -= prob->facility_cost[f];
     }
     if(isfinite(value)){
         double error = sol->value-value;
         if(error<0) error *= -1;
         if(error>=1e-5 && !isnan(error)) integrity = 0;
     }
+    if(isfinite(exact_value)){
+        double error = sol->value-exact_value;
+        if(error<0) error *= -1;
+        if(error>=1e-5 && !isnan(error)) integrity = 0;
+    }
 
     return integrity;
 }
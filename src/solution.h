@@ -3,24 +3,47 @@
 
 #include "utils.h"
 #include "rundata.h"
+#include "kernels.h"
 
 typedef struct {
     int n_facs;
     // ^ Number of facilities (size) of this solution.
     int *facs;
     // ^ Indexes of the facilities. Sorted.
-    int *assigns;
+    uint64_t *facs_bits;
+    // ^ Bitset of the facilities, NULL if prob->cache_facs_bits is disabled.
+    int facs_words;
+    // ^ Number of words of facs_bits (0 if it is NULL).
+    facidx *assigns;
     // ^ For each client, which facility it is assigned to. -1 means unnasigned.
+    costval *assign_costs;
+    // ^ For each client, the cost of its current assignment (INFINITY if unassigned).
+    //   NULL if prob->cache_assign_costs is disabled.
     double value;
     // ^ Value of the solution (> is better)
     int terminal;
     // ^ If the solution is a terminal one (didn't generate better childs).
+    int in_arena;
+    // ^ If the solution memory belongs to a solarena, then solution_free doesn't release it.
+    uint64_t hash;
+    // ^ Zobrist hash of the facilities (XOR of their hash_fac), updated on each add and remove.
+    double *sketch;
+    // ^ Random projections of the assignment costs (run->precomp->sketch_size values), used by the rpcd dissimilitude.
+    //   NULL until it is computed, except on solarenas that have space for them.
+    int sketch_valid;
+    // ^ If the sketch matches the assignment costs, it is cleared on each add and remove.
 } solution;
 
+// | Retrieves the cost of the current assignment of the client c
+static inline double solution_assig_cost(const problem *prob, const solution *sol, int c){
+    if(sol->assign_costs!=NULL) return sol->assign_costs[c];
+    return problem_assig_cost(prob,sol->assigns[c],c);
+}
+
 // solution* comparison to sort solution pointers on decreasing value
 int solutionp_value_cmp_inv(const void *a, const void *b);
 
-// solution* comparison for equality
+// solution* comparison for equality, solutions are sorted by hash first (and then by their bitsets, if they have them)
 int solutionp_facs_cmp(const void *a, const void *b);
 
 // Creates a new, empty solution.
@@ -32,6 +55,10 @@ solution *solution_copy(const problem *prob, const solution *sol);
 // Add a facility to an existing solution
 void solution_add(const problem *prob, solution *sol, int newf, int *affected);
 
+// Value that the solution would have after adding a facility that it doesn't have, without modifying it.
+// It is the same value that solution_add would give.
+double solution_value_after_add(const problem *prob, const solution *sol, int newf);
+
 // Remove a facility to an existing solution
 // The phi2 array is optional, if not NULL it should contain the second nearest facility
 // for each client.
@@ -40,7 +67,14 @@ void solution_remove(const problem *prob, solution *sol, int newf, int *phi2, in
 // An upper bound for the best value that a children solution could have
 double solution_upper_bound(const rundata *run, const solution *sol);
 
-// Delete solution
+// Computes the sketch of the solution from scratch.
+void solution_sketch_compute(const rundata *run, solution *sol);
+
+// Computes the sketch of the solution from the one of origin, only projecting the clients whose assignment differs,
+// from scratch if origin doesn't have a valid sketch.
+void solution_sketch_update(const rundata *run, solution *sol, const solution *origin);
+
+// Delete solution, does nothing for solutions on a solarena
 void solution_free(solution *sol);
 
 // Compute dissimilitude between solutions with the given dissimilitude mode and facility distance mode
@@ -0,0 +1,163 @@
+#include "threadpool.h"
+
+#include <unistd.h>
+#ifdef __linux__
+    #include <linux/futex.h>
+    #include <sys/syscall.h>
+#endif
+
+#define THREADPOOL_BARRIER_SPINS 4000
+
+static void *threadpool_worker_execution(void *arg){
+    threadpool_worker *worker = (threadpool_worker *) arg;
+    threadpool *pool = worker->pool;
+    long long int last_job_id = 0;
+    pthread_mutex_lock(&pool->mutex);
+    while(1){
+        // Wait for a new job
+        while(pool->job_id==last_job_id && !pool->terminate){
+            pthread_cond_wait(&pool->job_cond,&pool->mutex);
+        }
+        if(pool->terminate) break;
+        last_job_id = pool->job_id;
+        void *(*function)(void *) = pool->function;
+        void *args = pool->args+pool->arg_size*worker->thread_id;
+        pthread_mutex_unlock(&pool->mutex);
+        // Run the job
+        function(args);
+        // Inform that the job finished
+        pthread_mutex_lock(&pool->mutex);
+        pool->n_running -= 1;
+        if(pool->n_running==0) pthread_cond_signal(&pool->done_cond);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return NULL;
+}
+
+threadpool *threadpool_init(int n_threads){
+    assert(n_threads>0);
+    threadpool *pool = safe_malloc(sizeof(threadpool));
+    pool->n_threads = n_threads;
+    pthread_mutex_init(&pool->mutex,NULL);
+    pthread_cond_init(&pool->job_cond,NULL);
+    pthread_cond_init(&pool->done_cond,NULL);
+    pool->function = NULL;
+    pool->args = NULL;
+    pool->arg_size = 0;
+    pool->job_id = 0;
+    pool->n_running = 0;
+    pool->terminate = 0;
+    // Create the workers
+    pool->threads = safe_malloc(sizeof(pthread_t)*n_threads);
+    pool->workers = safe_malloc(sizeof(threadpool_worker)*n_threads);
+    for(int i=0;i<n_threads;i++){
+        pool->workers[i].pool = pool;
+        pool->workers[i].thread_id = i;
+        int rc = pthread_create(&pool->threads[i],NULL,threadpool_worker_execution,&pool->workers[i]);
+        if(rc){
+            fprintf(stderr,"ERROR: Error %d on pthread_create\n",rc);
+            exit(1);
+        }
+    }
+    return pool;
+}
+
+void threadpool_free(threadpool *pool){
+    // Wake the workers for termination
+    pthread_mutex_lock(&pool->mutex);
+    assert(pool->n_running==0);
+    pool->terminate = 1;
+    pthread_cond_broadcast(&pool->job_cond);
+    pthread_mutex_unlock(&pool->mutex);
+    // Join them
+    for(int i=0;i<pool->n_threads;i++){
+        pthread_join(pool->threads[i],NULL);
+    }
+    pthread_cond_destroy(&pool->done_cond);
+    pthread_cond_destroy(&pool->job_cond);
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool->workers);
+    free(pool->threads);
+    free(pool);
+}
+
+void threadpool_start(threadpool *pool, void *(*function)(void *), void *args, size_t arg_size){
+    pthread_mutex_lock(&pool->mutex);
+    assert(pool->n_running==0);
+    pool->function = function;
+    pool->args = (char *) args;
+    pool->arg_size = arg_size;
+    pool->n_running = pool->n_threads;
+    pool->job_id += 1;
+    pthread_cond_broadcast(&pool->job_cond);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+void threadpool_wait(threadpool *pool){
+    pthread_mutex_lock(&pool->mutex);
+    while(pool->n_running>0){
+        pthread_cond_wait(&pool->done_cond,&pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+void threadpool_execute(threadpool *pool, void *(*function)(void *), void *args, size_t arg_size){
+    threadpool_start(pool,function,args,arg_size);
+    threadpool_wait(pool);
+}
+
+void threadpool_barrier_init(threadpool_barrier *barrier, int n_threads){
+    assert(n_threads>0);
+    barrier->n_threads = n_threads;
+    // Spinning only helps if the other threads are running at the same time
+    long n_procs = sysconf(_SC_NPROCESSORS_ONLN);
+    barrier->n_spins = (n_procs>0 && n_threads<=n_procs)? THREADPOOL_BARRIER_SPINS : 0;
+    barrier->n_arrived = 0;
+    barrier->round = 0;
+    pthread_mutex_init(&barrier->mutex,NULL);
+    pthread_cond_init(&barrier->cond,NULL);
+}
+
+int threadpool_barrier_wait(threadpool_barrier *barrier){
+    int round = __atomic_load_n(&barrier->round,__ATOMIC_ACQUIRE);
+    if(__atomic_add_fetch(&barrier->n_arrived,1,__ATOMIC_ACQ_REL)==barrier->n_threads){
+        // Last thread, start the next round and release the others
+        __atomic_store_n(&barrier->n_arrived,0,__ATOMIC_RELAXED);
+        #ifdef __linux__
+            __atomic_store_n(&barrier->round,round+1,__ATOMIC_RELEASE);
+            syscall(SYS_futex,&barrier->round,FUTEX_WAKE_PRIVATE,INT_MAX,NULL,NULL,0);
+        #else
+            pthread_mutex_lock(&barrier->mutex);
+            __atomic_store_n(&barrier->round,round+1,__ATOMIC_RELEASE);
+            pthread_cond_broadcast(&barrier->cond);
+            pthread_mutex_unlock(&barrier->mutex);
+        #endif
+        return 1;
+    }
+    // Spin for a while
+    for(int s=0;s<barrier->n_spins;s++){
+        if(__atomic_load_n(&barrier->round,__ATOMIC_ACQUIRE)!=round) return 0;
+        #if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+        #endif
+    }
+    // Block
+    #ifdef __linux__
+        // The futex only sleeps if the round didn't change yet
+        while(__atomic_load_n(&barrier->round,__ATOMIC_ACQUIRE)==round){
+            syscall(SYS_futex,&barrier->round,FUTEX_WAIT_PRIVATE,round,NULL,NULL,0);
+        }
+    #else
+        pthread_mutex_lock(&barrier->mutex);
+        while(__atomic_load_n(&barrier->round,__ATOMIC_ACQUIRE)==round){
+            pthread_cond_wait(&barrier->cond,&barrier->mutex);
+        }
+        pthread_mutex_unlock(&barrier->mutex);
+    #endif
+    return 0;
+}
+
+void threadpool_barrier_destroy(threadpool_barrier *barrier){
+    pthread_cond_destroy(&barrier->cond);
+    pthread_mutex_destroy(&barrier->mutex);
+}
@@ -0,0 +1,91 @@
+#ifndef DC_THREADPOOL_H
+#define DC_THREADPOOL_H
+
+#include "utils.h"
+
+/*
+A pool of worker threads, created once for the whole run, so that the parallel phases of
+each generation don't have to create and join their threads.
+Each job runs a function once on every worker, worker i gets the i-th element of an array of
+arguments (as the threads of each phase used to), so all of them run at the same time
+and can synchronize between them or with the caller.
+*/
+
+struct threadpool;
+
+typedef struct {
+    struct threadpool *pool;
+    int thread_id;
+} threadpool_worker;
+
+typedef struct threadpool {
+    // | Number of worker threads.
+    int n_threads;
+    pthread_t *threads;
+    threadpool_worker *workers;
+    // | Protects the fields below.
+    pthread_mutex_t mutex;
+    // | Signals the workers that there is a new job (or that they must terminate).
+    pthread_cond_t job_cond;
+    // | Signals the caller that all the workers finished the current job.
+    pthread_cond_t done_cond;
+    // | Current job, worker i calls function(args+i*arg_size).
+    void *(*function)(void *);
+    char *args;
+    size_t arg_size;
+    // | Incremented on each job, so that each worker runs it once.
+    long long int job_id;
+    // | Number of workers that haven't finished the current job.
+    int n_running;
+    // | If the workers must terminate.
+    int terminate;
+} threadpool;
+
+// Claims the next item of a job whose items are distributed dynamically between the workers,
+// from a counter shared by all of them that starts at 0. There are no more items when the result
+// is greater or equal than their number. Workers that finish their items early keep claiming
+// more of them, instead of waiting for the others.
+static inline int threadpool_claim(int *counter){
+    return __atomic_fetch_add(counter,1,__ATOMIC_RELAXED);
+}
+
+// Barrier for the workers of a job that synchronize many times on it.
+// Waiting threads spin for a while before blocking, as they are usually released soon.
+typedef struct {
+    int n_threads;
+    // | Number of spins before blocking, 0 when there are more threads than processors.
+    int n_spins;
+    // | Number of threads that arrived to the current round.
+    int n_arrived;
+    // | Incremented when all the threads arrive.
+    int round;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+} threadpool_barrier;
+
+// Initializes a barrier for n_threads threads.
+void threadpool_barrier_init(threadpool_barrier *barrier, int n_threads);
+
+// Waits until all the threads arrive to the barrier, returns 1 on the last thread to arrive and 0 on the others.
+int threadpool_barrier_wait(threadpool_barrier *barrier);
+
+// Frees the resources of a barrier.
+void threadpool_barrier_destroy(threadpool_barrier *barrier);
+
+// Creates a pool with n_threads workers.
+threadpool *threadpool_init(int n_threads);
+
+// Terminates the workers and frees the pool, no job can be running.
+void threadpool_free(threadpool *pool);
+
+// Starts a job on all the workers of the pool and returns without waiting for it.
+// Only a job can be running at the same time.
+void threadpool_start(threadpool *pool, void *(*function)(void *), void *args, size_t arg_size);
+
+// Waits until all the workers finish the current job.
+void threadpool_wait(threadpool *pool);
+
+// Runs a job on all the workers of the pool and waits for it.
+void threadpool_execute(threadpool *pool, void *(*function)(void *), void *args, size_t arg_size);
+
+#endif
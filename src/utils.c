@@ -30,6 +30,22 @@ void *safe_realloc(void *original, size_t size){
     return ptr;
 }
 
+void *safe_aligned_malloc(size_t alignment, size_t size){
+    void *ptr = NULL;
+    int err = posix_memalign(&ptr,alignment,size>0? size : alignment);
+    if(err!=0){
+        fprintf(stderr,"ERROR (on %lu B aligned malloc, errno: %d): %s\n",size,err,strerror(err));
+        int currRealMem, peakRealMem, currVirtMem, peakVirtMem;
+        get_memory_usage(&currRealMem,&peakRealMem,&currVirtMem,&peakVirtMem);
+        fprintf(stderr,"currRealMem: %d kB\n",currRealMem);
+        fprintf(stderr,"peakRealMem: %d kB\n",peakRealMem);
+        fprintf(stderr,"currVirtMem: %d kB\n",currVirtMem);
+        fprintf(stderr,"peakVirtmem: %d kB\n",peakVirtMem);
+        exit(1);
+    }
+    return ptr;
+}
+
 // Thanks to user Thomas Mueller: https://stackoverflow.com/a/12996028
 uint hash_int(uint x){
     x = ((x >> 16)^x)*0x45d9f3b;
@@ -38,6 +54,14 @@ uint hash_int(uint x){
     return x;
 }
 
+// splitmix64 finalizer, so the keys don't have to be stored on a table
+uint64_t hash_fac(int f){
+    uint64_t x = (uint64_t)f + 0x9e3779b97f4a7c15ULL;
+    x = (x^(x>>30))*0xbf58476d1ce4e5b9ULL;
+    x = (x^(x>>27))*0x94d049bb133111ebULL;
+    return x^(x>>31);
+}
+
 void add_to_sorted(int *array, int *len, int val){
     int place = *len;
     while(place>0){
@@ -79,6 +103,20 @@ int elem_in_sorted(int *array, int len, int val){
     return 0;
 }
 
+int lower_bound_sorted(const int *array, int len, int val){
+    int a = 0;
+    int b = len;
+    while(a<b){
+        int c = (a+b)/2;
+        if(array[c]<val){
+            a = c+1;
+        }else{
+            b = c;
+        }
+    }
+    return a;
+}
+
 int diff_sorted(int *arr1, int len1, int *arr2, int len2){
     int diff = 0;
     int i1 = 0;
@@ -97,7 +135,7 @@ int diff_sorted(int *arr1, int len1, int *arr2, int len2){
             i2 += 1;
         }
     }
-    diff += (i1<i2)? i2-i1 : i1-i2;
+    diff += (len1-i1)+(len2-i2);
     return diff;
 }
 
@@ -8,6 +8,7 @@
 #include <errno.h>
 #include <math.h>
 #include <limits.h>
+#include <stdint.h>
 
 #include <pthread.h>
 #include <semaphore.h>
@@ -27,15 +28,41 @@ typedef unsigned int uint;
 // Auxiliar functions:
 void *safe_malloc(size_t size);
 void *safe_realloc(void *original, size_t size);
+// Allocates memory starting on an address multiple of alignment (a power of 2), free with free.
+void *safe_aligned_malloc(size_t alignment, size_t size);
 
 uint hash_int(uint x);
+// 64-bit key of a facility, the (Zobrist) hash of a set of facilities is the XOR of their keys.
+uint64_t hash_fac(int f);
 void add_to_sorted(int *array, int *len, int val);
 void rem_of_sorted(int *array, int *len, int val);
 int elem_in_sorted(int *array, int len, int val);
+// Retrieves the position of the first element of the sorted array that is not lower than val; in O(log len) time
+int lower_bound_sorted(const int *array, int len, int val);
 
 // Retrieves on how many values both sorted arrays differ; in O(len1+len2) time
 int diff_sorted(int *arr1, int len1, int *arr2, int len2);
 
+// Number of 64-bit words of a bitset of n bits.
+static inline int bitset_words(int n){
+    return (n+63)/64;
+}
+static inline void bitset_set(uint64_t *bits, int i){
+    bits[i>>6] |= ((uint64_t) 1)<<(i&63);
+}
+static inline void bitset_clear(uint64_t *bits, int i){
+    bits[i>>6] &= ~(((uint64_t) 1)<<(i&63));
+}
+static inline int bitset_test(const uint64_t *bits, int i){
+    return (bits[i>>6]>>(i&63))&1;
+}
+// Retrieves on how many bits both bitsets differ (as diff_sorted on their elements); in O(n_words) time
+static inline int bitset_diff(const uint64_t *bits1, const uint64_t *bits2, int n_words){
+    int diff = 0;
+    for(int w=0;w<n_words;w++) diff += __builtin_popcountll(bits1[w]^bits2[w]);
+    return diff;
+}
+
 // Semaphore initialization
 sem_t *dc_semaphore_init();
 // Semaphore destruction